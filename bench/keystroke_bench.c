@@ -0,0 +1,89 @@
+// Measures the time from a keypress to the redraw, with and without the swap
+// file, to show what recording each change costs.
+//
+//   keystroke_bench <editor> [keys]
+//
+// Each run types the given number of characters (2000 by default) one at a
+// time into a 10000 line file, waiting for the redraw after each one.
+
+#include "pty_editor.h"
+
+static int compareTimes(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *) a;
+  int64_t y = *(const int64_t *) b;
+  return (x > y) - (x < y);
+}
+
+static bool runKeys(char *editor, const char *home, const char *path, const char *config,
+                    int keys, const char *label)
+{
+  char *argv[] = {editor, "-c", (char *) config, (char *) path, NULL};
+
+  PtyEditor ed;
+  if (!ptyStart(&ed, argv, home))
+    return false;
+  ptyDrain(&ed, 300);
+
+  int64_t *times = malloc(sizeof(int64_t) * keys);
+  for (int i = 0; i < keys; i++)
+  {
+    char key = "abcdefghij"[i % 10];
+
+    int64_t start = ptyNow();
+    ptySend(&ed, &key, 1);
+
+    // The first byte of the redraw, then the rest of it
+    struct pollfd pfd = {.fd = ed.fd, .events = POLLIN};
+    poll(&pfd, 1, 1000);
+    times[i] = ptyNow() - start;
+    ptyDrain(&ed, 2);
+  }
+
+  ptySend(&ed, "\x18\x18", 2);
+  bool ok = ptyWaitExit(&ed) == 0;
+
+  qsort(times, keys, sizeof(int64_t), compareTimes);
+  int64_t sum = 0;
+  for (int i = 0; i < keys; i++)
+    sum += times[i];
+  printf("%-28s mean %4lld us  median %4lld us  p99 %5lld us\n", label,
+         (long long) (sum / keys), (long long) times[keys / 2],
+         (long long) times[keys * 99 / 100]);
+
+  free(times);
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s <editor> [keys]\n", argv[0]);
+    return 1;
+  }
+  int keys = argc > 2 ? atoi(argv[2]) : 2000;
+  if (keys <= 0)
+    return 1;
+
+  char home[] = "/tmp/lex_bench_XXXXXX";
+  if (!mkdtemp(home))
+    return 1;
+
+  char path[64];
+  snprintf(path, sizeof(path), "%s/keys.txt", home);
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    return 1;
+  for (int i = 0; i < 10000; i++)
+    fprintf(fp, "row %05d of the file being typed into\n", i);
+  fclose(fp);
+
+  bool ok = runKeys(argv[1], home, path, "swap_file 0", keys, "no swap file") &&
+            runKeys(argv[1], home, path, "swap_file 1", keys, "swap file, synced every 1 s") &&
+            runKeys(argv[1], home, path, "swap_sync 0", keys, "swap file, synced every key");
+
+  char command[96];
+  snprintf(command, sizeof(command), "rm -rf %s", home);
+  return ok && system(command) == 0 ? 0 : 1;
+}
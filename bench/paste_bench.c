@@ -0,0 +1,68 @@
+// Measures how fast a bracketed paste goes through the terminal input.
+//
+//   paste_bench <editor> [lines]
+//
+// A paste of the given number of lines (20000 by default, about 1 MB) is
+// written to a new file, then the editor is told to quit. The time from the
+// first pasted byte to the exit is reported, next to the time of quitting
+// without a paste.
+
+#include "pty_editor.h"
+
+static int64_t runPaste(char *editor, const char *home, const char *path, const char *data,
+                        size_t size)
+{
+  char *argv[] = {editor, (char *) path, NULL};
+
+  PtyEditor ed;
+  if (!ptyStart(&ed, argv, home))
+    return -1;
+  ptyDrain(&ed, 300);
+
+  // Quit twice, the second time past the unsaved changes warning
+  int64_t start = ptyNow();
+  ptySend(&ed, data, size);
+  ptySend(&ed, "\x18\x18", 2);
+  int status = ptyWaitExit(&ed);
+  return status == 0 ? ptyNow() - start : -1;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s <editor> [lines]\n", argv[0]);
+    return 1;
+  }
+  int lines = argc > 2 ? atoi(argv[2]) : 20000;
+
+  char home[] = "/tmp/lex_bench_XXXXXX";
+  if (!mkdtemp(home))
+    return 1;
+  char path[64];
+  snprintf(path, sizeof(path), "%s/paste.txt", home);
+
+  size_t size = 0;
+  char  *data = malloc((size_t) lines * 64 + 16);
+  size += sprintf(&data[size], "\x1b[200~");
+  for (int i = 0; i < lines; i++)
+    size += sprintf(&data[size], "line %08d of pasted text, padding padding pad\r", i);
+  size += sprintf(&data[size], "\x1b[201~");
+
+  int64_t base  = runPaste(argv[1], home, path, data, 0);
+  int64_t paste = runPaste(argv[1], home, path, data, size);
+  free(data);
+  if (base < 0 || paste < 0)
+  {
+    printf("The editor didn't exit cleanly.\n");
+    return 1;
+  }
+
+  double mb = (double) size / (1 << 20);
+  printf("%d lines (%.1f MB): %.3f s, quitting alone %.3f s, %.1f MB/s\n", lines, mb, paste / 1e6,
+         base / 1e6, mb / ((paste - base) / 1e6));
+
+  char command[96];
+  snprintf(command, sizeof(command), "rm -rf %s", home);
+  return system(command) == 0 ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+#ifndef PTY_EDITOR_H
+#define PTY_EDITOR_H
+
+// Runs the editor on a pseudo terminal, for benchmarks that go through the
+// same input and output path as a user. POSIX only.
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+typedef struct PtyEditor
+{
+  pid_t pid;
+  int   fd;
+} PtyEditor;
+
+static inline int64_t ptyNow(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * ptyStart - Start the editor on a new pseudo terminal
+ * @ed: Output
+ * @argv: Editor and its arguments, NULL terminated
+ * @home: Home directory of the editor, where it keeps its config, undo
+ *        journals and swap files
+ *
+ * Returns: false if the terminal couldn't be created
+ */
+static inline bool ptyStart(PtyEditor *ed, char *const argv[], const char *home)
+{
+  struct winsize size = {.ws_row = 24, .ws_col = 80};
+
+  ed->pid = forkpty(&ed->fd, NULL, NULL, &size);
+  if (ed->pid < 0)
+    return false;
+
+  if (ed->pid == 0)
+  {
+    setenv("HOME", home, 1);
+    setenv("TERM", "xterm-256color", 1);
+    execv(argv[0], argv);
+    _exit(127);
+  }
+  return true;
+}
+
+/**
+ * ptyDrain - Read the output of the editor until it goes quiet
+ * @ed: The editor
+ * @quiet_ms: Time without output that ends the wait
+ *
+ * Returns: Bytes read
+ */
+static inline size_t ptyDrain(PtyEditor *ed, int quiet_ms)
+{
+  char   buf[65536];
+  size_t total = 0;
+
+  struct pollfd pfd = {.fd = ed->fd, .events = POLLIN};
+  while (poll(&pfd, 1, quiet_ms) > 0)
+  {
+    ssize_t n = read(ed->fd, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+    total += (size_t) n;
+  }
+  return total;
+}
+
+/**
+ * ptySend - Write input to the editor
+ * @ed: The editor
+ * @data: The input
+ * @size: Bytes of @data
+ *
+ * The output is read meanwhile, so a big input can't block on a full
+ * terminal.
+ */
+static inline void ptySend(PtyEditor *ed, const char *data, size_t size)
+{
+  char buf[65536];
+  while (size)
+  {
+    struct pollfd pfd = {.fd = ed->fd, .events = POLLIN | POLLOUT};
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+      return;
+
+    if (pfd.revents & POLLIN)
+    {
+      if (read(ed->fd, buf, sizeof(buf)) <= 0)
+        return;
+    }
+    if (pfd.revents & POLLOUT)
+    {
+      ssize_t n = write(ed->fd, data, size < 4096 ? size : 4096);
+      if (n < 0 && errno != EAGAIN && errno != EINTR)
+        return;
+      if (n > 0)
+      {
+        data += n;
+        size -= (size_t) n;
+      }
+    }
+  }
+}
+
+/**
+ * ptyWaitExit - Wait for the editor to exit, reading its output
+ * @ed: The editor
+ *
+ * Returns: Exit status, -1 if it didn't exit normally
+ */
+static inline int ptyWaitExit(PtyEditor *ed)
+{
+  int status;
+  while (waitpid(ed->pid, &status, WNOHANG) == 0)
+    ptyDrain(ed, 10);
+  close(ed->fd);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static inline void ptyKill(PtyEditor *ed)
+{
+  kill(ed->pid, SIGKILL);
+  ptyWaitExit(ed);
+}
+
+#endif
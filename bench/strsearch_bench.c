@@ -0,0 +1,146 @@
+// Measures the throughput of StrSearch against the old byte by byte search,
+// searching every line of a file for a few queries like find does.
+//
+//   strsearch_bench [file]
+//
+// Without a file, 64 MB of generated log lines are searched.
+
+#include "core_utils.h"
+#include "strsearch_ref.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void terminalExit(void) {}
+int  writeConsole(const void *buf, size_t count)
+{
+  UNUSED(buf);
+  return (int) count;
+}
+
+// Microseconds, without the OS layer that needs the terminal
+static int64_t nowUs(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+typedef struct Line
+{
+  const char *data;
+  size_t      len;
+} Line;
+
+static char *generateLog(size_t size)
+{
+  static const char *levels[]  = {"INFO", "WARN", "ERROR", "DEBUG"};
+  static const char *actions[] = {"request served", "cache miss", "retrying upstream",
+                                  "connection refused", "status=200", "status=503",
+                                  "timeout waiting for lock"};
+
+  char  *buf = malloc_s(size + 128);
+  size_t len = 0;
+  for (unsigned i = 0; len < size; i++)
+  {
+    len += sprintf(&buf[len], "2024-05-%02u 12:%02u:%02u %s worker-%u %s id=%08x\n", i % 28 + 1,
+                   i / 60 % 60, i % 60, levels[i * 7 % 4], i % 16, actions[i * 13 % 7],
+                   i * 2654435761u);
+  }
+  buf[len] = '\0';
+  return buf;
+}
+
+static char *readFile(const char *path)
+{
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  char *buf = malloc_s(size + 1);
+  if (fread(buf, 1, size, fp) != (size_t) size)
+    size = 0;
+  buf[size] = '\0';
+  fclose(fp);
+  return buf;
+}
+
+int main(int argc, char *argv[])
+{
+  char *buf = argc > 1 ? readFile(argv[1]) : generateLog((size_t) 64 << 20);
+  if (!buf)
+  {
+    printf("Can't read %s\n", argv[1]);
+    return 1;
+  }
+
+  VECTOR(Line) lines = {0};
+  size_t size        = strlen(buf);
+  for (char *p = buf, *end; (end = strchr(p, '\n')); p = end + 1)
+  {
+    Line line = {p, (size_t) (end - p)};
+    vector_push(lines, line);
+  }
+
+  static const char *queries[] = {"e", "ERROR", "timeout", "connection refused", "zzzz",
+                                  "status=503"};
+
+  printf("%zu MB, %zu lines\n", size >> 20, lines.size);
+  printf("%-20s %-6s %10s %10s %10s\n", "query", "case", "matches", "old GB/s", "new GB/s");
+  for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++)
+  {
+    for (int ignore_case = 0; ignore_case < 2; ignore_case++)
+    {
+      const char *query = queries[q];
+      size_t      len   = strlen(query);
+
+      int64_t start = nowUs();
+      size_t  old   = 0;
+      for (size_t i = 0; i < lines.size; i++)
+      {
+        int m;
+        for (size_t col = 0;
+             (m = refFindSubstring(lines.data[i].data, lines.data[i].len, query, len, col,
+                                   ignore_case)) >= 0;
+             col = m + len)
+        {
+          old++;
+        }
+      }
+
+      int64_t   middle = nowUs();
+      size_t    found  = 0;
+      StrSearch search;
+      strSearchInit(&search, query, len, ignore_case);
+      for (size_t i = 0; i < lines.size; i++)
+      {
+        int m;
+        for (size_t col = 0;
+             (m = strSearchNext(&search, lines.data[i].data, lines.data[i].len, col)) >= 0;
+             col = m + len)
+        {
+          found++;
+        }
+      }
+      int64_t end = nowUs();
+
+      if (found != old)
+      {
+        printf("%s: %zu matches, the reference found %zu\n", query, found, old);
+        return 1;
+      }
+      printf("%-20s %-6s %10zu %10.2f %10.2f\n", query, ignore_case ? "nocase" : "case", found,
+             size / 1e3 / (middle - start), size / 1e3 / (end - middle));
+    }
+  }
+
+  free(lines.data);
+  free(buf);
+  return 0;
+}
@@ -0,0 +1,95 @@
+// Compares StrSearch with the old byte by byte search on random input.
+// Exits with 1 and prints the case on the first difference.
+
+#include "core_utils.h"
+#include "strsearch_ref.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// core_utils.c reports fatal errors through the terminal
+void terminalExit(void) {}
+int  writeConsole(const void *buf, size_t count)
+{
+  UNUSED(buf);
+  return (int) count;
+}
+
+// Small xorshift generator, so runs repeat on every platform
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void fill(char *buf, size_t len, const char *alphabet)
+{
+  size_t size = strlen(alphabet);
+  for (size_t i = 0; i < len; i++)
+    buf[i] = alphabet[rng() % size];
+}
+
+static bool check(const char *haystack, size_t haystack_len, const char *needle,
+                  size_t needle_len, size_t start, bool ignore_case)
+{
+  StrSearch search;
+  strSearchInit(&search, needle, needle_len, ignore_case);
+
+  int expected = refFindSubstring(haystack, haystack_len, needle, needle_len, start, ignore_case);
+  int found    = strSearchNext(&search, haystack, haystack_len, start);
+  if (found == expected)
+    return true;
+
+  printf("Mismatch: expected %d, found %d (start %zu, %s)\n", expected, found, start,
+         ignore_case ? "ignore case" : "match case");
+  printf("  needle   \"%.*s\"\n", (int) needle_len, needle);
+  printf("  haystack \"%.*s\"\n", (int) haystack_len, haystack);
+  return false;
+}
+
+int main(int argc, char *argv[])
+{
+  long rounds = argc > 1 ? atol(argv[1]) : 2000000;
+  if (argc > 2)
+    rng_state = (uint32_t) atol(argv[2]) | 1;
+
+  // Short rows over alphabets that make partial matches common, with bytes
+  // past ASCII that must never fold
+  static const char *alphabets[] = {"aAbB", "abcdeABCDE xyz!.-\x80\xc3\xff"};
+  for (long i = 0; i < rounds; i++)
+  {
+    char   haystack[200];
+    char   needle[12];
+    size_t haystack_len = rng() % sizeof(haystack);
+    size_t needle_len   = rng() % 8;
+
+    const char *alphabet = alphabets[i & 1];
+    fill(haystack, haystack_len, alphabet);
+    fill(needle, needle_len, alphabet);
+
+    if (!check(haystack, haystack_len, needle, needle_len, rng() % 210, rng() & 1))
+      return 1;
+  }
+
+  // Long rows of near misses, so the search falls back to Horspool
+  for (long i = 0; i < rounds / 100; i++)
+  {
+    static char haystack[5000];
+    char        needle[40];
+    size_t      haystack_len = 1000 + rng() % 4000;
+    size_t      needle_len   = 3 + rng() % 30;
+
+    fill(haystack, haystack_len, "aab");
+    fill(needle, needle_len, "aabB");
+
+    if (!check(haystack, haystack_len, needle, needle_len, 0, rng() & 1))
+      return 1;
+  }
+
+  printf("%ld searches matched the reference.\n", rounds + rounds / 100);
+  return 0;
+}
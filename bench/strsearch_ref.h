@@ -0,0 +1,55 @@
+#ifndef STRSEARCH_REF_H
+#define STRSEARCH_REF_H
+
+#include <ctype.h>
+
+/**
+ * refFindSubstring - The byte by byte search used before StrSearch
+ * @haystack: String to search
+ * @haystack_len: Length of @haystack
+ * @needle: String to find
+ * @needle_len: Length of @needle
+ * @start: First position to look at
+ * @ignore_case: Whether to compare ASCII letters without case
+ *
+ * Kept as the reference StrSearch is checked and measured against.
+ *
+ * Returns: Position of the first match at or after @start, -1 if none
+ */
+static inline int refFindSubstring(const char *haystack, size_t haystack_len, const char *needle,
+                                   size_t needle_len, size_t start, bool ignore_case)
+{
+  if (needle_len == 0)
+    return (start <= haystack_len) ? (int) start : -1;
+
+  if (haystack_len < needle_len)
+    return -1;
+
+  size_t limit = haystack_len - needle_len;
+  if (start > limit)
+    return -1;
+
+  for (size_t i = start; i <= limit; ++i)
+  {
+    size_t j = 0;
+    for (; j < needle_len; ++j)
+    {
+      uint8_t hay = (uint8_t) haystack[i + j];
+      uint8_t nee = (uint8_t) needle[j];
+      if (ignore_case)
+      {
+        if (tolower(hay) != tolower(nee))
+          break;
+      }
+      else if (hay != nee)
+      {
+        break;
+      }
+    }
+    if (j == needle_len)
+      return (int) i;
+  }
+  return -1;
+}
+
+#endif
@@ -1,33 +1,795 @@
 #include "core_action.h"
 
+#include "core_config.h"
 #include "core_editor.h"
+#include "core_os.h"
+#include "core_prompt.h"
+#include "core_utils.h"
+
+// Size of the length stored after each encoded action
+#define UNDO_TRAILER_SIZE 4
+
+// Texts of at least this many bytes are shared with the log, not copied
+#define UNDO_SHARE_MIN 1024
+
+// Journal header: magic, content hash and length of the history
+#define UNDO_JOURNAL_MAGIC "LEXUNDO1"
+#define UNDO_JOURNAL_HEADER 24
+
+// Swap file header: magic and hash of the content the changes apply to
+#define SWAP_MAGIC "LEXSWAP1"
+#define SWAP_HEADER 16
+
+// Each swap record starts with the length and a checksum of the action
+#define SWAP_RECORD_HEADER 8
+
+static void logReserve(EditorUndoLog *log, size_t extra)
+{
+  if (log->size + extra <= log->capacity)
+    return;
+
+  size_t capacity = log->capacity ? log->capacity : 256;
+  while (capacity < log->size + extra)
+    capacity += capacity / 2;
+
+  log->data     = realloc_s(log->data, capacity);
+  log->capacity = capacity;
+}
+
+static void logPutBytes(EditorUndoLog *log, const void *data, size_t size)
+{
+  logReserve(log, size);
+  memcpy(&log->data[log->size], data, size);
+  log->size += size;
+}
+
+static void logPutVarint(EditorUndoLog *log, uint64_t value)
+{
+  uint8_t buf[10];
+  size_t  len = 0;
+  do
+  {
+    buf[len] = value & 0x7F;
+    value >>= 7;
+    if (value)
+      buf[len] |= 0x80;
+    len++;
+  } while (value);
+  logPutBytes(log, buf, len);
+}
+
+static uint64_t getVarint(const uint8_t **p)
+{
+  uint64_t value = 0;
+  int      shift = 0;
+  uint8_t  byte;
+  do
+  {
+    byte = *(*p)++;
+    value |= (uint64_t) (byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+static void logPutRange(EditorUndoLog *log, const EditorSelectRange *range)
+{
+  logPutVarint(log, range->start_x);
+  logPutVarint(log, range->start_y);
+  logPutVarint(log, range->end_x);
+  logPutVarint(log, range->end_y);
+}
+
+static void getRange(const uint8_t **p, EditorSelectRange *range)
+{
+  range->start_x = getVarint(p);
+  range->start_y = getVarint(p);
+  range->end_x   = getVarint(p);
+  range->end_y   = getVarint(p);
+}
+
+static void logPutCursor(EditorUndoLog *log, const EditorCursor *cursor)
+{
+  logPutVarint(log, cursor->x);
+  logPutVarint(log, cursor->y);
+  logPutVarint(log, cursor->is_selected);
+  logPutVarint(log, cursor->select_x);
+  logPutVarint(log, cursor->select_y);
+}
+
+static void getCursor(const uint8_t **p, EditorCursor *cursor)
+{
+  cursor->x           = getVarint(p);
+  cursor->y           = getVarint(p);
+  cursor->is_selected = getVarint(p);
+  cursor->select_x    = getVarint(p);
+  cursor->select_y    = getVarint(p);
+}
+
+static size_t textBytes(const EditorClipboard *text)
+{
+  size_t bytes = 0;
+  for (size_t i = 0; i < text->size; i++)
+    bytes += text->lines[i].size;
+  return bytes;
+}
+
+/**
+ * logPutText - Encode the text of an action
+ * @log: The history
+ * @text: The text
+ * @share: Keep a reference to big texts instead of copying them
+ *
+ * A shared text is stored as a pointer to its EditorTextBlock, which the
+ * log holds a reference to. Journals only get copies.
+ */
+static void logPutText(EditorUndoLog *log, EditorClipboard *text, bool share)
+{
+  size_t bytes = textBytes(text);
+  if (share && bytes >= UNDO_SHARE_MIN)
+  {
+    EditorClipboard ref;
+    editorShareClipboard(&ref, text);
+    log->shared += bytes;
+    logPutVarint(log, (uint64_t) text->size << 1 | 1);
+    logPutVarint(log, (uintptr_t) ref.block);
+    return;
+  }
+
+  logPutVarint(log, (uint64_t) text->size << 1);
+  for (size_t i = 0; i < text->size; i++)
+  {
+    logPutVarint(log, text->lines[i].size);
+    logPutBytes(log, text->lines[i].data, text->lines[i].size);
+  }
+}
+
+// The lines point into the log or a shared block, only the line array of
+// copied text is allocated
+static void getText(const uint8_t **p, EditorClipboard *text)
+{
+  uint64_t header = getVarint(p);
+  text->size      = header >> 1;
+  text->block     = NULL;
+
+  if (header & 1)
+  {
+    text->block = (EditorTextBlock *) (uintptr_t) getVarint(p);
+    text->lines = text->block->lines;
+    return;
+  }
+
+  text->lines = text->size ? malloc_s(sizeof(Str) * text->size) : NULL;
+  for (size_t i = 0; i < text->size; i++)
+  {
+    text->lines[i].size = getVarint(p);
+    text->lines[i].data = (char *) *p;
+    *p += text->lines[i].size;
+  }
+}
+
+/**
+ * logPutAction - Encode an action at the end of the log
+ * @log: The history
+ * @action: The action to encode
+ * @share: Share big texts with @action, see logPutText()
+ */
+static void logPutAction(EditorUndoLog *log, EditorAction *action, bool share)
+{
+  size_t start = log->size;
+
+  uint8_t type = action->type;
+  logPutBytes(log, &type, 1);
+
+  switch (action->type)
+  {
+    case ACTION_EDIT:
+    {
+      EditAction *edit = &action->edit;
+      logPutVarint(log, edit->merge);
+      logPutVarint(log, edit->time);
+      logPutRange(log, &edit->deleted_range);
+      logPutRange(log, &edit->added_range);
+      logPutCursor(log, &edit->old_cursor);
+      logPutCursor(log, &edit->new_cursor);
+      logPutText(log, &edit->deleted_text, share);
+      logPutText(log, &edit->added_text, share);
+    }
+    break;
+
+    case ACTION_ATTRI:
+      logPutVarint(log, action->attri.old_newline);
+      logPutVarint(log, action->attri.new_newline);
+      break;
+  }
+
+  uint32_t len = log->size - start;
+  uint8_t  trailer[UNDO_TRAILER_SIZE];
+  for (int i = 0; i < UNDO_TRAILER_SIZE; i++)
+    trailer[i] = len >> (i * 8);
+  logPutBytes(log, trailer, UNDO_TRAILER_SIZE);
+}
+
+/**
+ * logGetAction - Decode the action starting at an offset
+ * @log: The history
+ * @offset: Start of the action
+ * @action: Output, release with releaseAction()
+ *
+ * The text of the decoded action points into the log, so it is only valid
+ * until the log is modified.
+ *
+ * Returns: Offset of the end of the action
+ */
+static size_t logGetAction(const EditorUndoLog *log, size_t offset, EditorAction *action)
+{
+  const uint8_t *p = &log->data[offset];
+
+  memset(action, 0, sizeof(EditorAction));
+  action->type = *p++;
+
+  switch (action->type)
+  {
+    case ACTION_EDIT:
+    {
+      EditAction *edit = &action->edit;
+      edit->merge      = getVarint(&p);
+      edit->time       = getVarint(&p);
+      getRange(&p, &edit->deleted_range);
+      getRange(&p, &edit->added_range);
+      getCursor(&p, &edit->old_cursor);
+      getCursor(&p, &edit->new_cursor);
+      getText(&p, &edit->deleted_text);
+      getText(&p, &edit->added_text);
+    }
+    break;
+
+    case ACTION_ATTRI:
+      action->attri.old_newline = getVarint(&p);
+      action->attri.new_newline = getVarint(&p);
+      break;
+  }
+
+  return (p - log->data) + UNDO_TRAILER_SIZE;
+}
+
+static void releaseAction(EditorAction *action)
+{
+  if (action->type == ACTION_EDIT)
+  {
+    if (!action->edit.deleted_text.block)
+      free(action->edit.deleted_text.lines);
+    if (!action->edit.added_text.block)
+      free(action->edit.added_text.lines);
+  }
+}
+
+// Bytes of the shared texts of an action
+static size_t sharedBytes(const EditorAction *action)
+{
+  size_t bytes = 0;
+  if (action->type == ACTION_EDIT)
+  {
+    if (action->edit.deleted_text.block)
+      bytes += textBytes(&action->edit.deleted_text);
+    if (action->edit.added_text.block)
+      bytes += textBytes(&action->edit.added_text);
+  }
+  return bytes;
+}
+
+// Let go of the shared texts of the actions in [@from, @to)
+static void logReleaseRange(EditorUndoLog *log, size_t from, size_t to)
+{
+  while (from < to)
+  {
+    EditorAction action;
+    from = logGetAction(log, from, &action);
+    log->shared -= sharedBytes(&action);
+    if (action.type == ACTION_EDIT)
+    {
+      if (action.edit.deleted_text.block)
+        editorFreeClipboardContent(&action.edit.deleted_text);
+      if (action.edit.added_text.block)
+        editorFreeClipboardContent(&action.edit.added_text);
+    }
+    releaseAction(&action);
+  }
+}
+
+// Memory held by the action in [@start, @end), including shared texts
+static size_t logCost(const EditorUndoLog *log, size_t start, size_t end)
+{
+  EditorAction action;
+  logGetAction(log, start, &action);
+  size_t cost = end - start + sharedBytes(&action);
+  releaseAction(&action);
+  return cost;
+}
+
+static uint32_t getTrailer(const uint8_t *trailer)
+{
+  uint32_t len = 0;
+  for (int i = 0; i < UNDO_TRAILER_SIZE; i++)
+    len |= (uint32_t) trailer[i] << (i * 8);
+  return len;
+}
+
+// Start of the action that ends at @end
+static size_t logPrevious(const EditorUndoLog *log, size_t end)
+{
+  return end - UNDO_TRAILER_SIZE - getTrailer(&log->data[end - UNDO_TRAILER_SIZE]);
+}
+
+// Compare a file with the state on disk, hashing only changed rows
+static void updateDirty(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+
+  file->dirty = file->num_rows != log->saved_rows || file->bytes != log->saved_bytes ||
+                file->newline != log->saved_newline;
+  if (file->dirty || log->changes.start < 0)
+    return;
+
+  int end = log->changes.end < file->num_rows ? log->changes.end : file->num_rows;
+  for (int i = log->changes.start; i < end; i++)
+  {
+    if (editorRowHash(&file->row[i]) != log->saved_row_hashes[i])
+    {
+      file->dirty = 1;
+      return;
+    }
+  }
+
+  // Same as on disk again, later checks start from here
+  log->changes = ROWS_UNCHANGED;
+}
+
+static uint64_t hashPath(const char *filename)
+{
+  return hashBytes(HASH_INIT, filename, strlen(filename));
+}
+
+// Path of a file in @dir of the config directory named after a path hash
+static void getConfigPath(const char *dir, uint64_t name, char *path, size_t size)
+{
+  snprintf(path, size, PATH_CAT("%s", CONF_DIR, "%s" DIR_SEP "%016llx"), getenv(ENV_HOME), dir,
+           (unsigned long long) name);
+}
+
+static void getJournalPath(const EditorFile *file, char *path, size_t size)
+{
+  getConfigPath("undo", hashPath(file->filename), path, size);
+}
+
+// Create the config directories leading to @path and open it with @mode
+static FILE *createConfigFile(char *path, const char *mode)
+{
+  for (char *p = path + strlen(getenv(ENV_HOME)) + 1; *p; p++)
+  {
+    if (*p != DIR_SEP[0])
+      continue;
+    *p          = '\0';
+    bool exists = makeDir(path);
+    *p          = DIR_SEP[0];
+    if (!exists)
+      return NULL;
+  }
+  return openFile(path, mode);
+}
+
+static bool journalWrite(FILE *fp, size_t offset, const void *data, size_t size)
+{
+  return fseek(fp, UNDO_JOURNAL_HEADER + offset, SEEK_SET) == 0 &&
+         fwrite(data, 1, size, fp) == size;
+}
+
+static bool journalRead(FILE *fp, size_t offset, void *data, size_t size)
+{
+  return fseek(fp, UNDO_JOURNAL_HEADER + offset, SEEK_SET) == 0 &&
+         fread(data, 1, size, fp) == size;
+}
+
+// An invalid header marks a journal that is in use or incomplete
+static bool journalWriteHeader(FILE *fp, bool valid, uint64_t hash, uint64_t length)
+{
+  uint8_t header[UNDO_JOURNAL_HEADER] = {0};
+  if (valid)
+    memcpy(header, UNDO_JOURNAL_MAGIC, 8);
+  for (int i = 0; i < 8; i++)
+  {
+    header[8 + i]  = hash >> (i * 8);
+    header[16 + i] = length >> (i * 8);
+  }
+  return fseek(fp, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+         fflush(fp) == 0;
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++)
+    value |= (uint32_t) p[i] << (i * 8);
+  return value;
+}
+
+static uint64_t getU64(const uint8_t *p)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++)
+    value |= (uint64_t) p[i] << (i * 8);
+  return value;
+}
+
+static FILE *journalCreate(const EditorFile *file)
+{
+  char path[EDITOR_PATH_MAX];
+  getJournalPath(file, path, sizeof(path));
+
+  FILE *fp = createConfigFile(path, "w+b");
+  if (fp && !journalWriteHeader(fp, false, 0, 0))
+  {
+    fclose(fp);
+    fp = NULL;
+  }
+  return fp;
+}
+
+static void journalRemove(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+  if (!log->journal)
+    return;
+
+  fclose(log->journal);
+  log->journal = NULL;
+
+  char path[EDITOR_PATH_MAX];
+  getJournalPath(file, path, sizeof(path));
+  removeFile(path);
+}
+
+/**
+ * journalAppend - Write the oldest actions in memory to the journal
+ * @log: The history
+ * @to: End of the last action to write
+ * @written: Output, bytes written to the journal
+ *
+ * Shared texts are copied into the journal, so its size can differ from
+ * @to. The saved position is moved to match.
+ *
+ * Returns: false on error
+ */
+static bool journalAppend(EditorUndoLog *log, size_t to, size_t *written)
+{
+  EditorUndoLog copy  = {0};
+  size_t        saved = log->saved;
+
+  for (size_t at = 0; at < to;)
+  {
+    if (log->base + at == log->saved)
+      saved = log->base + copy.size;
+
+    EditorAction action;
+    at = logGetAction(log, at, &action);
+    logPutAction(&copy, &action, false);
+    releaseAction(&action);
+  }
+
+  bool ok = journalWrite(log->journal, log->base, copy.data, copy.size);
+  if (ok && log->saved != SIZE_MAX && log->saved >= log->base + to)
+    saved = log->saved - to + copy.size;
+  if (ok)
+    log->saved = saved;
+
+  *written = copy.size;
+  free(copy.data);
+  return ok;
+}
+
+// Give up on the journal after an I/O error, the spilled actions are lost
+static void logForgetJournal(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+  journalRemove(file);
+  if (log->saved != SIZE_MAX)
+    log->saved = log->saved >= log->base ? log->saved - log->base : SIZE_MAX;
+  log->base = 0;
+}
+
+/**
+ * logCompact - Spill or discard the oldest actions when over the budget
+ * @file: The file of the history
+ *
+ * Goes down to three quarters of the budget so the log isn't moved on
+ * every append. The newest action is always kept in memory.
+ */
+static void logCompact(EditorFile *file)
+{
+  EditorUndoLog *log    = &file->undo;
+  size_t         budget = (size_t) CONVAR_GETINT(undo_budget) * 1024;
+  if (budget == 0 || log->size + log->shared <= budget)
+    return;
+
+  size_t target = budget / 4 * 3;
+  size_t cut    = logPrevious(log, log->size);
+  size_t kept   = logCost(log, cut, log->size);
+  while (cut > 0)
+  {
+    size_t start = logPrevious(log, cut);
+    size_t cost  = logCost(log, start, cut);
+    if (kept + cost > target)
+      break;
+    kept += cost;
+    cut = start;
+  }
+
+  if (CONVAR_GETINT(undo_file) && file->filename)
+  {
+    if (!log->journal)
+      log->journal = journalCreate(file);
+
+    size_t written;
+    if (log->journal && journalAppend(log, cut, &written))
+    {
+      logReleaseRange(log, 0, cut);
+      memmove(log->data, &log->data[cut], log->size - cut);
+      log->size -= cut;
+      log->current -= cut;
+      log->base += written;
+      return;
+    }
+  }
+
+  // Older actions in a journal can't be reached once the ones after them are gone
+  logForgetJournal(file);
+
+  size_t dropped = 0;
+  for (size_t end = cut; end > 0; end = logPrevious(log, end))
+    dropped++;
+
+  logReleaseRange(log, 0, cut);
+  memmove(log->data, &log->data[cut], log->size - cut);
+  log->size -= cut;
+  log->current -= cut;
+  log->dropped += dropped;
+  if (log->saved != SIZE_MAX)
+    log->saved = log->saved >= cut ? log->saved - cut : SIZE_MAX;
+}
+
+/**
+ * logUnspill - Read the newest spilled actions back into memory
+ * @file: The file of the history
+ *
+ * Loads about a quarter of the budget, at least one action.
+ *
+ * Returns: true if an action was loaded
+ */
+static bool logUnspill(EditorFile *file)
+{
+  EditorUndoLog *log    = &file->undo;
+  size_t         budget = (size_t) CONVAR_GETINT(undo_budget) * 1024;
+  size_t         target = budget ? budget / 4 : SIZE_MAX;
+
+  if (!log->journal || log->base == 0)
+    return false;
+
+  size_t start = log->base;
+  while (start > 0 && log->base - start < target)
+  {
+    uint8_t trailer[UNDO_TRAILER_SIZE];
+    if (start < UNDO_TRAILER_SIZE ||
+        !journalRead(log->journal, start - UNDO_TRAILER_SIZE, trailer, UNDO_TRAILER_SIZE))
+      goto fail;
+
+    size_t len = getTrailer(trailer) + UNDO_TRAILER_SIZE;
+    if (len > start)
+      goto fail;
+    start -= len;
+  }
+
+  size_t len = log->base - start;
+  logReserve(log, len);
+  memmove(&log->data[len], log->data, log->size);
+  if (!journalRead(log->journal, start, log->data, len))
+  {
+    memmove(log->data, &log->data[len], log->size);
+    goto fail;
+  }
+
+  log->size += len;
+  log->current += len;
+  log->base = start;
+  return true;
+
+fail:
+  logForgetJournal(file);
+  return false;
+}
+
+static FILE *swapCreate(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+  log->swap_name     = hashPath(file->filename);
+
+  char path[EDITOR_PATH_MAX];
+  getConfigPath("swap", log->swap_name, path, sizeof(path));
+
+  // Appending doesn't cut the swap file of another instance before the lock
+  FILE *fp = createConfigFile(path, "ab");
+  if (!fp)
+    return NULL;
+
+  if (!lockFile(fp))
+  {
+    fclose(fp);
+    log->swap_busy = true;
+    editorMsg("\"%s\" is open in another instance, no swap file is kept for it.",
+              getBaseName(file->filename));
+    return NULL;
+  }
+
+  uint8_t header[SWAP_HEADER];
+  memcpy(header, SWAP_MAGIC, 8);
+  for (int i = 0; i < 8; i++)
+    header[8 + i] = log->saved_hash >> (i * 8);
+  if (!truncateFile(fp) || fwrite(header, 1, sizeof(header), fp) != sizeof(header))
+  {
+    fclose(fp);
+    removeFile(path);
+    return NULL;
+  }
+  return fp;
+}
+
+static void swapRemove(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+  if (!log->swap)
+    return;
+
+  fclose(log->swap);
+  log->swap         = NULL;
+  log->swap_pending = 0;
+
+  char path[EDITOR_PATH_MAX];
+  getConfigPath("swap", log->swap_name, path, sizeof(path));
+  removeFile(path);
+}
+
+static void swapSync(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+  if (!syncFile(log->swap))
+    editorMsg("Can't sync the swap file of \"%s\"!", getBaseName(file->filename));
+  log->swap_pending = 0;
+}
+
+/**
+ * swapWrite - Record a change to the content in the swap file
+ * @file: The changed file
+ * @action: The change, as it would be redone
+ *
+ * The record is flushed to the OS right away, so it survives the editor
+ * being killed. Syncing it to the disk is batched by the swap_sync convar,
+ * see editorSyncSwap().
+ */
+static void swapWrite(EditorFile *file, EditorAction *action)
+{
+  // Reused between calls, it only grows to the biggest change
+  static EditorUndoLog record;
+
+  EditorUndoLog *log = &file->undo;
+  if (!file->filename)
+    return;
+
+  // A swap file that misses changes would restore the wrong content
+  if (!CONVAR_GETINT(swap_file))
+  {
+    swapRemove(file);
+    return;
+  }
+
+  if (!log->swap)
+  {
+    if (log->swap_busy)
+      return;
+    log->swap = swapCreate(file);
+    if (!log->swap)
+      return;
+  }
+
+  uint8_t header[SWAP_RECORD_HEADER] = {0};
+  record.size                        = 0;
+  logPutBytes(&record, header, sizeof(header));
+  logPutAction(&record, action, false);
+
+  uint32_t len   = record.size - SWAP_RECORD_HEADER;
+  uint32_t check = hashBytes(HASH_INIT, &record.data[SWAP_RECORD_HEADER], len);
+  for (int i = 0; i < 4; i++)
+  {
+    record.data[i]     = len >> (i * 8);
+    record.data[4 + i] = check >> (i * 8);
+  }
+
+  if (fwrite(record.data, 1, record.size, log->swap) != record.size || fflush(log->swap) != 0)
+  {
+    editorMsg("Can't write the swap file of \"%s\"!", getBaseName(file->filename));
+    swapRemove(file);
+    return;
+  }
+
+  int64_t now = getTime();
+  if (!log->swap_pending)
+    log->swap_pending = now;
+  if (now - log->swap_pending >= (int64_t) CONVAR_GETINT(swap_sync) * 1000)
+    swapSync(file);
+}
+
+// Turn an action into the one that undoes it
+static void invertAction(EditorAction *action)
+{
+  switch (action->type)
+  {
+    case ACTION_EDIT:
+    {
+      EditAction       *edit   = &action->edit;
+      EditorSelectRange range  = edit->deleted_range;
+      EditorClipboard   text   = edit->deleted_text;
+      EditorCursor      cursor = edit->old_cursor;
+
+      edit->deleted_range = edit->added_range;
+      edit->deleted_text  = edit->added_text;
+      edit->old_cursor    = edit->new_cursor;
+      edit->added_range   = range;
+      edit->added_text    = text;
+      edit->new_cursor    = cursor;
+    }
+    break;
+
+    case ACTION_ATTRI:
+    {
+      int newline                = action->attri.old_newline;
+      action->attri.old_newline = action->attri.new_newline;
+      action->attri.new_newline = newline;
+    }
+    break;
+  }
+}
 
 /**
  * editorUndo - Undo the last action performed in the editor
- * 
+ *
  * Returns: true if undo was successful, false if there's nothing to undo
  */
 bool editorUndo(void)
 {
-  // Check if we're at the beginning of action history (nothing to undo)
-  if (gCurFile->action_current == gCurFile->action_head)
+  EditorUndoLog *log = &gCurFile->undo;
+
+  // Check if we're at the beginning of action history (nothing to undo),
+  // older actions may still be in the journal
+  if (log->current == 0 && !logUnspill(gCurFile))
     return false;
 
+  size_t       start = logPrevious(log, log->current);
+  EditorAction action;
+  logGetAction(log, start, &action);
+
   // Handle different action types
-  switch (gCurFile->action_current->action->type)
+  switch (action.type)
   {
     case ACTION_EDIT:
     {
       // Get the edit action details
-      EditAction *edit = &gCurFile->action_current->action->edit;
-      
+      EditAction *edit = &action.edit;
+
       // Delete the text that was added
       editorDeleteText(edit->added_range);
-      
+
       // Restore the text that was deleted
       editorPasteText(&edit->deleted_text, edit->deleted_range.start_x,
                       edit->deleted_range.start_y);
-      
+
       // Restore the old cursor position
       gCurFile->cursor = edit->old_cursor;
     }
@@ -36,51 +798,45 @@ bool editorUndo(void)
     case ACTION_ATTRI:
     {
       // Get the attribute action details
-      AttributeAction *attri = &gCurFile->action_current->action->attri;
-      
+      AttributeAction *attri = &action.attri;
+
       // Restore the old newline setting
       gCurFile->newline      = attri->old_newline;
     }
     break;
   }
 
-  // Move current action pointer to previous action
-  gCurFile->action_current = gCurFile->action_current->prev;
-  
-  // Decrement dirty flag (file modification counter)
-  gCurFile->dirty--;
-  
+  // The swap file records the undo as a change of its own
+  invertAction(&action);
+  swapWrite(gCurFile, &action);
+  releaseAction(&action);
+
+  // Move current position to the previous action
+  log->current = start;
+
+  // Undo may return to the saved content or leave it
+  updateDirty(gCurFile);
+
   return true;
 }
 
-/**
- * editorRedo - Redo the previously undone action
- * 
- * Returns: true if redo was successful, false if there's nothing to redo
- */
-bool editorRedo(void)
+// Apply an action to the current file again
+static void applyAction(const EditorAction *action)
 {
-  // Check if there's a next action to redo
-  if (!gCurFile->action_current->next)
-    return false;
-
-  // Move current action pointer to next action
-  gCurFile->action_current = gCurFile->action_current->next;
-
   // Handle different action types
-  switch (gCurFile->action_current->action->type)
+  switch (action->type)
   {
     case ACTION_EDIT:
     {
       // Get the edit action details
-      EditAction *edit = &gCurFile->action_current->action->edit;
-      
+      const EditAction *edit = &action->edit;
+
       // Delete the text that was previously there
       editorDeleteText(edit->deleted_range);
-      
+
       // Re-add the text that was added in this action
       editorPasteText(&edit->added_text, edit->added_range.start_x, edit->added_range.start_y);
-      
+
       // Restore the new cursor position
       gCurFile->cursor = edit->new_cursor;
     }
@@ -89,24 +845,208 @@ bool editorRedo(void)
     case ACTION_ATTRI:
     {
       // Get the attribute action details
-      AttributeAction *attri = &gCurFile->action_current->action->attri;
-      
+      const AttributeAction *attri = &action->attri;
+
       // Restore the new newline setting
-      gCurFile->newline      = attri->new_newline;
+      gCurFile->newline            = attri->new_newline;
     }
     break;
   }
+}
+
+/**
+ * editorRedo - Redo the previously undone action
+ *
+ * Returns: true if redo was successful, false if there's nothing to redo
+ */
+bool editorRedo(void)
+{
+  EditorUndoLog *log = &gCurFile->undo;
+
+  // Check if there's a next action to redo
+  if (log->current == log->size)
+    return false;
+
+  EditorAction action;
+  size_t       end = logGetAction(log, log->current, &action);
+
+  applyAction(&action);
+  swapWrite(gCurFile, &action);
+  releaseAction(&action);
+
+  // Move current position past the redone action
+  log->current = end;
+
+  updateDirty(gCurFile);
 
-  // Increment dirty flag (file modification counter)
-  gCurFile->dirty++;
-  
   return true;
 }
 
+// A word starts between a separator or space and an identifier character
+static bool isWordStart(char left, char right)
+{
+  return isNonIdentifierChar((uint8_t) left) && !isNonIdentifierChar((uint8_t) right);
+}
+
+/**
+ * editorMergeAction - Merge typing into the current action
+ * @action: The new action
+ *
+ * The current action is decoded, extended and encoded again in place of
+ * the old copy. It is the last one in the log, so nothing else moves.
+ *
+ * Returns: true if @action was merged and can be freed, false if it needs
+ * its own undo step
+ */
+static bool editorMergeAction(const EditorAction *action)
+{
+  if (action->type != ACTION_EDIT || action->edit.merge == EDIT_MERGE_NONE)
+    return false;
+
+  int64_t max_gap = CONVAR_GETINT(undo_merge);
+  if (max_gap <= 0)
+    return false;
+
+  // Only the newest action can grow, and never the one that was just saved
+  EditorUndoLog *log = &gCurFile->undo;
+  if (log->current == 0 || log->current != log->size || log->saved == log->base + log->current)
+    return false;
+
+  size_t       start = logPrevious(log, log->current);
+  EditorAction current;
+  logGetAction(log, start, &current);
+
+  EditAction       *prev = &current.edit;
+  const EditAction *edit = &action->edit;
+
+  bool merged = false;
+  Str  text_merged;
+
+  if (current.type != ACTION_EDIT || prev->merge != edit->merge ||
+      edit->time - prev->time > max_gap * 1000)
+    goto done;
+
+  // Shared texts are immutable
+  if (prev->deleted_text.block || prev->added_text.block)
+    goto done;
+
+  // The cursor moved in between
+  if (prev->new_cursor.x != edit->old_cursor.x || prev->new_cursor.y != edit->old_cursor.y)
+    goto done;
+
+  bool break_word = CONVAR_GETINT(undo_word);
+
+  EditorClipboard *prev_clip = NULL;
+  const Str       *left;
+  const Str       *right;
+
+  if (edit->merge == EDIT_MERGE_INSERT)
+  {
+    if (prev->added_text.size != 1 || edit->added_text.size != 1)
+      goto done;
+
+    const EditorSelectRange *range      = &edit->added_range;
+    EditorSelectRange       *prev_range = &prev->added_range;
+    if (range->start_y != prev_range->end_y || range->start_x != prev_range->end_x)
+      goto done;
+
+    prev_clip         = &prev->added_text;
+    left              = &prev->added_text.lines[0];
+    right             = &edit->added_text.lines[0];
+    prev_range->end_x = range->end_x;
+  }
+  else
+  {
+    if (prev->deleted_text.size != 1 || edit->deleted_text.size != 1)
+      goto done;
+
+    const EditorSelectRange *range      = &edit->deleted_range;
+    EditorSelectRange       *prev_range = &prev->deleted_range;
+    if (range->start_y != prev_range->start_y)
+      goto done;
+
+    prev_clip = &prev->deleted_text;
+    if (range->end_x == prev_range->start_x)
+    {
+      // Backspace
+      left                = &edit->deleted_text.lines[0];
+      right               = &prev->deleted_text.lines[0];
+      prev_range->start_x = range->start_x;
+    }
+    else if (range->start_x == prev_range->start_x)
+    {
+      // Delete
+      left  = &prev->deleted_text.lines[0];
+      right = &edit->deleted_text.lines[0];
+      prev_range->end_x += edit->deleted_text.lines[0].size;
+    }
+    else
+    {
+      goto done;
+    }
+  }
+
+  if (break_word && isWordStart(left->data[left->size - 1], right->data[0]))
+    goto done;
+
+  // The old text lives in the log that is about to be overwritten
+  text_merged.size = left->size + right->size;
+  text_merged.data = malloc_s(text_merged.size);
+  memcpy(text_merged.data, left->data, left->size);
+  memcpy(&text_merged.data[left->size], right->data, right->size);
+  prev_clip->lines[0] = text_merged;
+
+  prev->new_cursor = edit->new_cursor;
+  prev->time       = edit->time;
+
+  log->size = start;
+  logPutAction(log, &current, false);
+  log->current = log->size;
+
+  free(text_merged.data);
+  merged = true;
+
+done:
+  releaseAction(&current);
+  return merged;
+}
+
+/**
+ * logAppend - Add an action that was just applied to the current file
+ * @action: The action
+ * @share: Share big texts with @action, see logPutText()
+ */
+static void logAppend(EditorAction *action, bool share)
+{
+  EditorUndoLog *log = &gCurFile->undo;
+
+  swapWrite(gCurFile, action);
+
+  // A change may also restore the saved content, e.g. typing and deleting
+  updateDirty(gCurFile);
+
+  // Typing that continues the current action doesn't get its own step
+  if (editorMergeAction(action))
+    return;
+
+  // Discard any actions after current position (clear redo history)
+  logReleaseRange(log, log->current, log->size);
+  log->size = log->current;
+  if (log->saved != SIZE_MAX && log->saved > log->base + log->current)
+    log->saved = SIZE_MAX;
+
+  // Encode the action and move the current position past it
+  logPutAction(log, action, share);
+  log->current = log->size;
+
+  // Stay within the memory budget
+  logCompact(gCurFile);
+}
+
 /**
  * editorAppendAction - Add a new action to the action history
  * @action: The action to append to the history
- * 
+ *
  * This function adds a new action to the undo/redo history and handles
  * clearing any redo history after the current position.
  */
@@ -116,39 +1056,291 @@ void editorAppendAction(EditorAction *action)
   if (!action)
     return;
 
-  // Allocate memory for new action list node
-  EditorActionList *node = malloc_s(sizeof(EditorActionList));
-  node->action           = action;
-  node->next             = NULL;
+  // Big texts are shared with the action instead of copied
+  logAppend(action, true);
+
+  editorFreeAction(action);
+}
+
+size_t editorUndoLogCount(const EditorUndoLog *log)
+{
+  size_t count = 0;
+  for (size_t end = log->size; end > 0; end = logPrevious(log, end))
+    count++;
+  return count;
+}
+
+void editorLoadUndoLog(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+
+  // The content was just read from disk
+  log->saved_hash       = editorHashFile(file);
+  log->saved_rows       = file->num_rows;
+  log->saved_bytes      = file->bytes;
+  log->saved_newline    = file->newline;
+  log->saved_row_hashes = malloc_s(sizeof(uint64_t) * (file->num_rows ? file->num_rows : 1));
+  for (int i = 0; i < file->num_rows; i++)
+    log->saved_row_hashes[i] = file->row[i].hash;
+  log->changes = ROWS_UNCHANGED;
+
+  if (!CONVAR_GETINT(undo_file) || !file->filename)
+    return;
+
+  char path[EDITOR_PATH_MAX];
+  getJournalPath(file, path, sizeof(path));
+  FILE *fp = openFile(path, "r+b");
+  if (!fp)
+    return;
+
+  uint8_t header[UNDO_JOURNAL_HEADER];
+  if (fread(header, 1, sizeof(header), fp) == sizeof(header) &&
+      memcmp(header, UNDO_JOURNAL_MAGIC, 8) == 0 && getU64(&header[8]) == log->saved_hash &&
+      journalWriteHeader(fp, false, 0, 0))
+  {
+    log->journal = fp;
+    log->base    = getU64(&header[16]);
+    log->saved   = log->base;
+    return;
+  }
+
+  // Written for other content or never finished
+  fclose(fp);
+  removeFile(path);
+}
+
+// Length of the record at @at, false if it is missing or cut short
+static bool swapGetRecord(const uint8_t *data, size_t size, size_t at, uint32_t *len)
+{
+  if (size - at < SWAP_RECORD_HEADER)
+    return false;
+
+  *len = getU32(&data[at]);
+  if (*len > size - at - SWAP_RECORD_HEADER)
+    return false;
+
+  // A record cut short by the crash
+  const uint8_t *record = &data[at + SWAP_RECORD_HEADER];
+  return (uint32_t) hashBytes(HASH_INIT, record, *len) == getU32(&data[at + 4]);
+}
+
+void editorRecoverSwap(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+  if (!CONVAR_GETINT(swap_file) || !file->filename)
+    return;
+
+  char path[EDITOR_PATH_MAX];
+  getConfigPath("swap", hashPath(file->filename), path, sizeof(path));
+  FILE *fp = openFile(path, "rb");
+  if (!fp)
+    return;
+
+  // The editor writing it holds the lock, a crash releases it
+  const char *name = getBaseName(file->filename);
+  if (!lockFile(fp))
+  {
+    fclose(fp);
+    log->swap_busy = true;
+    editorMsg("\"%s\" is open in another instance, no swap file is kept for it.", name);
+    return;
+  }
+
+  uint8_t *data = NULL;
+  long     size = -1;
+  if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= SWAP_HEADER &&
+      fseek(fp, 0, SEEK_SET) == 0)
+  {
+    data = malloc_s(size);
+    if (fread(data, 1, size, fp) != (size_t) size)
+      size = -1;
+  }
+  fclose(fp);
+
+  if (size < SWAP_HEADER || memcmp(data, SWAP_MAGIC, 8) != 0 ||
+      getU64(&data[8]) != log->saved_hash)
+  {
+    // Written for other content, the changes can't be placed any more
+    editorMsg("Discarded the swap file of \"%s\", it doesn't match the file.", name);
+    free(data);
+    removeFile(path);
+    return;
+  }
+
+  size_t   count = 0;
+  uint32_t len;
+  for (size_t at = SWAP_HEADER; swapGetRecord(data, size, at, &len);
+       at += SWAP_RECORD_HEADER + len)
+  {
+    count++;
+  }
 
-  // Increment dirty flag (file has been modified)
-  gCurFile->dirty++;
+  if (count && !editorConfirm("Recover %zu unsaved changes of \"%s\" from the swap file? (y/n)",
+                              count, name))
+  {
+    editorMsg("Discarded the swap file of \"%s\".", name);
+    count = 0;
+  }
 
-  // Free any actions after current position (clear redo history)
-  editorFreeActionList(gCurFile->action_current->next);
+  // Changes are replayed on the file and written to a new swap file
+  EditorFile *current = gCurFile;
+  gCurFile            = file;
 
-  // Special case: if we're at the head (dummy node)
-  if (gCurFile->action_current == gCurFile->action_head)
+  size_t at = SWAP_HEADER;
+  for (size_t i = 0; i < count; i++)
   {
-    // Link the new node after the head
-    gCurFile->action_head->next = node;
-    node->prev                  = gCurFile->action_head;
-    gCurFile->action_current    = node;
+    swapGetRecord(data, size, at, &len);
+
+    EditorUndoLog record_log = {.data = &data[at + SWAP_RECORD_HEADER], .size = len};
+    EditorAction  action;
+    logGetAction(&record_log, 0, &action);
+    applyAction(&action);
+    logAppend(&action, false);
+    releaseAction(&action);
+
+    at += SWAP_RECORD_HEADER + len;
+  }
+
+  gCurFile = current;
+  free(data);
+
+  // Nothing was written to the new one
+  if (!file->undo.swap)
+    removeFile(path);
+
+  if (count)
+    editorMsg("Recovered %zu unsaved changes of \"%s\" from the swap file.", count, name);
+}
+
+int editorSyncSwap(void)
+{
+  int64_t now  = getTime();
+  int64_t wait = -1;
+
+  for (int i = 0; i < gEditor.file_count; i++)
+  {
+    EditorFile    *file = &gEditor.files[i];
+    EditorUndoLog *log  = &file->undo;
+    if (!log->swap_pending)
+      continue;
+
+    int64_t due = log->swap_pending + (int64_t) CONVAR_GETINT(swap_sync) * 1000 - now;
+    if (due <= 0)
+      swapSync(file);
+    else if (wait < 0 || due < wait)
+      wait = due;
+  }
+
+  return wait < 0 ? READ_WAIT_INFINITE : (int) ((wait + 999) / 1000);
+}
+
+/**
+ * swapRestart - Start the swap file over from the saved state
+ * @file: The file that was saved
+ *
+ * Changes made since the save started are written to the new swap file
+ * again, walking the history from the saved state to the current one.
+ */
+static void swapRestart(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+  swapRemove(file);
+
+  // Changes that are only in the journal can't be written again
+  if (log->saved == SIZE_MAX || log->saved < log->base)
     return;
+
+  size_t at = log->saved - log->base;
+  while (at < log->current)
+  {
+    EditorAction action;
+    at = logGetAction(log, at, &action);
+    swapWrite(file, &action);
+    releaseAction(&action);
   }
+  while (at > log->current)
+  {
+    EditorAction action;
+    at = logPrevious(log, at);
+    logGetAction(log, at, &action);
+    invertAction(&action);
+    swapWrite(file, &action);
+    releaseAction(&action);
+  }
+}
 
-  // Link the new node after current action
-  node->prev                     = gCurFile->action_current;
-  gCurFile->action_current->next = node;
-  
-  // Move current pointer to the newly added action
-  gCurFile->action_current       = gCurFile->action_current->next;
+void editorBeginUndoSave(EditorFile *file)
+{
+  file->undo.saved = file->undo.base + file->undo.current;
+}
+
+void editorEndUndoSave(EditorFile *file, EditorSnapshot *saved, uint64_t hash)
+{
+  EditorUndoLog *log = &file->undo;
+  if (saved)
+  {
+    free(log->saved_row_hashes);
+    log->saved_hash       = hash;
+    log->saved_rows       = saved->num_rows;
+    log->saved_bytes      = saved->bytes;
+    log->saved_newline    = saved->newline;
+    log->saved_row_hashes = saved->row_hashes;
+    log->changes          = saved->changes;
+    saved->row_hashes     = NULL;
+    swapRestart(file);
+  }
+  else
+  {
+    log->saved = SIZE_MAX;
+  }
+
+  // Edits made during the save are compared with what is on disk now
+  updateDirty(file);
+}
+
+void editorCloseUndoLog(EditorFile *file)
+{
+  EditorUndoLog *log = &file->undo;
+
+  // Only the history leading to the content on disk is useful next time
+  bool keep = CONVAR_GETINT(undo_file) && file->filename && log->saved != SIZE_MAX &&
+              log->saved > 0 &&
+              (log->saved <= log->base || log->saved - log->base <= log->size);
+
+  if (keep && !log->journal)
+    log->journal = journalCreate(file);
+
+  if (keep && log->journal)
+  {
+    size_t written;
+    if (log->saved > log->base)
+      keep = journalAppend(log, log->saved - log->base, &written);
+    keep = keep && journalWriteHeader(log->journal, true, log->saved_hash, log->saved);
+    fclose(log->journal);
+    log->journal = NULL;
+    if (!keep)
+    {
+      char path[EDITOR_PATH_MAX];
+      getJournalPath(file, path, sizeof(path));
+      removeFile(path);
+    }
+  }
+  else
+  {
+    journalRemove(file);
+  }
+  swapRemove(file);
+
+  logReleaseRange(log, 0, log->size);
+  free(log->data);
+  free(log->saved_row_hashes);
+  memset(log, 0, sizeof(EditorUndoLog));
 }
 
 /**
  * editorFreeAction - Free memory allocated for an editor action
  * @action: The action to free
- * 
+ *
  * Properly deallocates all memory associated with an action,
  * including any clipboard content for edit actions.
  */
@@ -163,7 +1355,7 @@ void editorFreeAction(EditorAction *action)
   {
     // Free the deleted text clipboard
     editorFreeClipboardContent(&action->edit.deleted_text);
-    
+
     // Free the added text clipboard
     editorFreeClipboardContent(&action->edit.added_text);
   }
@@ -171,31 +1363,3 @@ void editorFreeAction(EditorAction *action)
   // Free the action structure itself
   free(action);
 }
-
-/**
- * editorFreeActionList - Free an entire linked list of actions
- * @thisptr: Pointer to the first node in the list to free
- * 
- * Recursively frees all nodes in the action list starting from
- * the given pointer.
- */
-void editorFreeActionList(EditorActionList *thisptr)
-{
-  EditorActionList *temp;
-  
-  // Iterate through the list
-  while (thisptr)
-  {
-    // Save current node
-    temp    = thisptr;
-    
-    // Move to next node
-    thisptr = thisptr->next;
-    
-    // Free the action in current node
-    editorFreeAction(temp->action);
-    
-    // Free the node itself
-    free(temp);
-  }
-}
\ No newline at end of file
@@ -1,8 +1,12 @@
 #ifndef ACTION_H
 #define ACTION_H
 
+#include "core_row.h"
 #include "core_select.h"
 
+typedef struct EditorFile     EditorFile;
+typedef struct EditorSnapshot EditorSnapshot;
+
 /**
  * struct EditorCursor - Represents the cursor position and selection state
  * @x: Current cursor column position
@@ -22,6 +26,22 @@ typedef struct EditorCursor
   int  select_y;
 } EditorCursor;
 
+/**
+ * enum EditMergeType - How an edit may be merged with the previous one
+ * @EDIT_MERGE_NONE: Always a separate undo step
+ * @EDIT_MERGE_INSERT: Typed text
+ * @EDIT_MERGE_DELETE: Text removed with backspace or delete
+ *
+ * Consecutive typing of the same kind is merged into a single undo step,
+ * see editorAppendAction().
+ */
+typedef enum EditMergeType
+{
+  EDIT_MERGE_NONE,
+  EDIT_MERGE_INSERT,
+  EDIT_MERGE_DELETE,
+} EditMergeType;
+
 /**
  * struct EditAction - Represents a text editing action
  * @deleted_range: Range of text that was deleted
@@ -30,6 +50,8 @@ typedef struct EditorCursor
  * @added_text: Content of the added text
  * @old_cursor: Cursor state before the edit
  * @new_cursor: Cursor state after the edit
+ * @merge: Whether following keystrokes may be merged into this action
+ * @time: Time of the last keystroke merged into this action
  *
  * This structure captures all information needed to undo/redo
  * a text editing operation, including what was deleted, what was
@@ -45,6 +67,9 @@ typedef struct EditAction
 
   EditorCursor old_cursor;
   EditorCursor new_cursor;
+
+  EditMergeType merge;
+  int64_t       time;
 } EditAction;
 
 /**
@@ -96,21 +121,82 @@ typedef struct EditorAction
 } EditorAction;
 
 /**
- * struct EditorActionList - Doubly-linked list node for action history
- * @prev: Pointer to previous action in history
- * @next: Pointer to next action in history
- * @action: Pointer to the actual action data
+ * struct EditorUndoLog - Undo/redo history of a file
+ * @data: Encoded actions in memory, oldest first
+ * @size: Bytes used, including actions that can be redone
+ * @capacity: Allocated bytes
+ * @current: End of the last action that is applied to the file
+ * @dropped: Number of old actions discarded to stay within undo_budget
+ * @shared: Bytes of the texts the log holds references to
+ * @base: Bytes of older actions spilled to @journal, @data continues
+ *        after them
+ * @saved: Position of the state on disk, counting from the start of the
+ *         journal, SIZE_MAX if it can't be reached any more
+ * @journal: Journal file, NULL if not opened
+ * @saved_hash: Content hash of the state on disk, see editorHashFile()
+ * @saved_rows: Number of rows of the state on disk
+ * @saved_bytes: Bytes in the rows of the state on disk
+ * @saved_newline: Newline of the state on disk
+ * @saved_row_hashes: Hash of each row of the state on disk
+ * @changes: Rows changed since the state on disk
+ * @swap: Swap file, NULL if not opened
+ * @swap_name: Hash of the path @swap was created for
+ * @swap_pending: Time of the oldest swap write that isn't synced to disk,
+ *                0 if there is none
+ * @swap_busy: Another instance of the editor holds the swap file, no swap
+ *             file is written for this one
+ *
+ * The history is an append-only byte log. Each action is stored as its
+ * type, varint encoded ranges and cursors and the raw text of each line,
+ * followed by a 4-byte length so the log can also be walked backwards.
+ * Undo steps back over the action ending at @current, redo decodes the
+ * one starting there. Big texts, like pastes and cuts, are not copied into
+ * the log: it keeps a reference to their EditorTextBlock instead, which is
+ * shared with the clipboard.
+ *
+ * When the log grows past the undo_budget convar, the oldest actions are
+ * discarded by moving the rest to the front of the buffer. With undo_file
+ * enabled they are appended to a journal in the config directory instead
+ * and read back when undo reaches them, so memory stays flat. On close the
+ * history up to the saved state is written to the journal too, and the
+ * next open restores it if the file content still matches.
+ *
+ * With swap_file enabled, every change to the content since the last save
+ * is also appended to a swap file as it happens. The swap file is removed
+ * when the file is saved or closed, so one that is left over on open means
+ * the editor didn't exit cleanly and its changes can be replayed. The
+ * editor writing it holds a lock on it, so the same file opened twice
+ * doesn't share one.
  *
- * Forms a doubly-linked list to maintain the undo/redo history.
- * This allows traversing both forward (redo) and backward (undo)
- * through the action history.
+ * After every change the file is compared with the state on disk, first
+ * by its size and then by the hashes of the rows that were changed, so a
+ * change reverted by hand leaves the file clean just like undo does.
  */
-typedef struct EditorActionList
+typedef struct EditorUndoLog
 {
-  struct EditorActionList *prev;
-  struct EditorActionList *next;
-  EditorAction            *action;
-} EditorActionList;
+  uint8_t *data;
+  size_t   size;
+  size_t   capacity;
+  size_t   current;
+  size_t   dropped;
+  size_t   shared;
+
+  size_t   base;
+  size_t   saved;
+  FILE    *journal;
+
+  uint64_t         saved_hash;
+  int              saved_rows;
+  size_t           saved_bytes;
+  uint8_t          saved_newline;
+  uint64_t        *saved_row_hashes;
+  EditorRowChanges changes;
+
+  FILE    *swap;
+  uint64_t swap_name;
+  int64_t  swap_pending;
+  bool     swap_busy;
+} EditorUndoLog;
 
 /**
  * editorUndo - Undo the last action performed
@@ -130,19 +216,80 @@ bool editorRedo(void);
  * editorAppendAction - Add a new action to the history
  * @action: Pointer to the action to append
  *
- * Adds the action to the end of the history and clears any
- * redo history after the current position.
+ * Encodes the action to the end of the history, clears any redo
+ * history after the current position and frees @action.
+ *
+ * Typing that continues the current action (see EditMergeType) is merged
+ * into it instead. The undo_merge and undo_word convars control where a
+ * new undo step starts.
  */
 void editorAppendAction(EditorAction *action);
 
 /**
- * editorFreeActionList - Free a list of actions
- * @thisptr: Pointer to the first node to free
+ * editorUndoLogCount - Count the actions in a history
+ * @log: The history
+ *
+ * Returns: Number of actions, including those that can be redone
+ */
+size_t editorUndoLogCount(const EditorUndoLog *log);
+
+/**
+ * editorLoadUndoLog - Restore the history of a file from its journal
+ * @file: A file that was just opened
+ *
+ * The content is recorded as the state on disk first. The journal is only
+ * read if undo_file is enabled and it was written for the same content.
+ */
+void editorLoadUndoLog(EditorFile *file);
+
+/**
+ * editorRecoverSwap - Replay the changes left in the swap file of a file
+ * @file: A file that was just opened, its history already loaded
+ *
+ * Changes are only replayed if the swap file was written for the same
+ * content and the user agrees, they become new undo steps and leave the
+ * file modified. A swap file locked by another instance of the editor is
+ * left alone.
+ */
+void editorRecoverSwap(EditorFile *file);
+
+/**
+ * editorSyncSwap - Sync swap file writes that are due
+ *
+ * Returns: Milliseconds until the next pending write is due, or
+ * READ_WAIT_INFINITE if there is none
+ */
+int editorSyncSwap(void);
+
+/**
+ * editorBeginUndoSave - Remember the current state as the one being saved
+ * @file: The file being saved
+ *
+ * Edits can continue while the content is written, the history keeps
+ * track of where the saved state is.
+ */
+void editorBeginUndoSave(EditorFile *file);
+
+/**
+ * editorEndUndoSave - Finish a save started with editorBeginUndoSave()
+ * @file: The file that was saved
+ * @saved: Content that reached the disk, NULL if the save failed
+ * @hash: Content hash of @saved, see editorHashSnapshot()
+ *
+ * On success the swap file starts over from the saved state. Either way
+ * the file is compared with what is on disk now.
+ */
+void editorEndUndoSave(EditorFile *file, EditorSnapshot *saved, uint64_t hash);
+
+/**
+ * editorCloseUndoLog - Free the history of a file
+ * @file: The file being closed
  *
- * Recursively frees all nodes in the action list starting
- * from the given pointer.
+ * With undo_file enabled, the history up to the saved state is kept in
+ * the journal for the next time the file is opened. The swap file is
+ * removed.
  */
-void editorFreeActionList(EditorActionList *thisptr);
+void editorCloseUndoLog(EditorFile *file);
 
 /**
  * editorFreeAction - Free a single action
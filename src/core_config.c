@@ -4,6 +4,7 @@
 #include "core_editor.h"
 #include "core_input.h"
 #include "core_prompt.h"
+#include "core_screen.h"
 #include "core_terminal.h"
 
 EditorConCmdArgs args;
@@ -32,7 +33,26 @@ CONVAR(ex_show_hidden, "Show hidden files in the file explorer.", "1", cvarExplo
 CONVAR(newline_default, "Set the default EOL sequence (LF/CRLF). 0 is OS default.", "0", NULL);
 CONVAR(ttimeoutlen, "Time in milliseconds to wait for a key code sequence to complete.", "50",
        NULL);
+CONVAR(input_budget,
+       "Max time in milliseconds to apply queued input before redrawing. 0 redraws every key.",
+       "16", NULL);
+CONVAR(undo_merge,
+       "Merge typing into one undo step until a pause of this many milliseconds. 0 to disable.",
+       "1000", NULL);
+CONVAR(undo_word, "Start a new undo step at every word.", "1", NULL);
+CONVAR(undo_budget,
+       "Max undo history size of a file in KB. Older steps are dropped. 0 for no limit.", "16384",
+       NULL);
+CONVAR(undo_file, "Keep older undo steps in a journal file and restore them on reopen.", "0",
+       NULL);
+CONVAR(swap_file, "Record unsaved changes in a swap file to recover them after a crash.", "1",
+       NULL);
+CONVAR(swap_sync,
+       "Max time in milliseconds before swap file writes are synced to disk. 0 syncs every change.",
+       "1000", NULL);
 CONVAR(lilx, "Show line numbers.", "1", NULL);
+CONVAR(hl_window, "Rows longer than this are only highlighted around the view. 0 to disable.",
+       "10000", cvarSyntaxCallback);
 
 static void reloadSyntax(void)
 {
@@ -40,6 +60,7 @@ static void reloadSyntax(void)
   {
     for (int j = 0; j < gEditor.files[i].num_rows; j++)
     {
+      editorRowInvalidateSyntax(&gEditor.files[i].row[j], 0);
       editorUpdateRow(&gEditor.files[i], &gEditor.files[i].row[j]);
     }
   }
@@ -169,7 +190,30 @@ CON_COMMAND(color, "Change the color of an element.")
     if (!strToColor(args.argv[2], target))
     {
       editorMsg("Invalid color string \"%s\".", args.argv[2]);
+      return;
     }
+    editorUpdateColorSGR();
+    // Cells on screen refer to palette slots, repaint them
+    editorScreenInvalidate();
+  }
+}
+
+void editorUpdateColorSGR(void)
+{
+  const Color *colors = (const Color *) &gEditor.color_cfg;
+  for (int i = 0; i < EDITOR_COLOR_SLOTS; i++)
+  {
+    EditorColorSGR *sgr = &gEditor.color_sgr[i];
+    Color           c   = colors[i];
+
+    sgr->fg_len = snprintf(sgr->fg, sizeof(sgr->fg), "\x1b[38;2;%d;%d;%dm", c.r, c.g, c.b);
+
+    // Black backgrounds use the terminal default, the screen flush writes
+    // these prepared strings as they are
+    if (c.r == 0 && c.g == 0 && c.b == 0)
+      sgr->bg_len = snprintf(sgr->bg, sizeof(sgr->bg), "%s", ANSI_DEFAULT_BG);
+    else
+      sgr->bg_len = snprintf(sgr->bg, sizeof(sgr->bg), "\x1b[48;2;%d;%d;%dm", c.r, c.g, c.b);
   }
 }
 
@@ -220,7 +264,8 @@ CON_COMMAND(lang, "Set the syntax highlighting language of the current file.")
     // Match the language name or the externaion
     if (strCaseCmp(name, s->file_type) == 0)
     {
-      editorSetSyntaxHighlight(gCurFile, s);
+      if (!editorSetSyntaxHighlight(gCurFile, s))
+        editorMsg("lang: Canceled.");
       return;
     }
 
@@ -230,7 +275,8 @@ CON_COMMAND(lang, "Set the syntax highlighting language of the current file.")
       if ((is_ext && strCaseCmp(name, &s->file_exts.data[i][1]) == 0) ||
           (!is_ext && strCaseStr(name, s->file_exts.data[i])))
       {
-        editorSetSyntaxHighlight(gCurFile, s);
+        if (!editorSetSyntaxHighlight(gCurFile, s))
+          editorMsg("lang: Canceled.");
         return;
       }
     }
@@ -375,6 +421,44 @@ CON_COMMAND(version, "Print version info string.")
   editorMsg("Exe build: %s %s (%d)", editor_build_time, editor_build_date, editorGetBuildNumber());
 }
 
+CON_COMMAND(stats, "Print screen output and input statistics.")
+{
+  UNUSED(args.argc);
+
+  const EditorScreenStats *stats = editorScreenGetStats();
+  size_t                   avg   = stats->frames ? stats->total_bytes / stats->frames : 0;
+
+  editorMsg("Frames: %zu (%zu unchanged)", stats->frames, stats->empty_frames);
+  editorMsg("Last frame: %zu bytes, %zu cells", stats->last_bytes, stats->last_cells);
+  editorMsg("Bytes per frame: %zu avg, %zu max", avg, stats->max_bytes);
+
+  const EditorInputStats *input      = editorGetInputStats();
+  size_t                  avg_events = input->batches ? input->events / input->batches : 0;
+
+  editorMsg("Input: %zu events in %zu frames", input->events, input->batches);
+  editorMsg("Events per frame: %zu last, %zu avg, %zu max", input->last_batch, avg_events,
+            input->max_batch);
+}
+
+CON_COMMAND(undo_stats, "Print the undo history size of each open file.")
+{
+  UNUSED(args.argc);
+
+  for (int i = 0; i < gEditor.file_count; i++)
+  {
+    const EditorFile    *file = &gEditor.files[i];
+    const EditorUndoLog *log  = &file->undo;
+
+    char name[32];
+    if (!file->filename)
+      snprintf(name, sizeof(name), "Untitled-%d", file->new_id + 1);
+
+    editorMsg("%s: %zu steps, %zu bytes (%zu allocated, %zu shared), %zu spilled, %zu dropped",
+              file->filename ? getBaseName(file->filename) : name, editorUndoLogCount(log),
+              log->size, log->capacity, log->shared, log->base, log->dropped);
+  }
+}
+
 static void showCmdHelp(const EditorConCmd *cmd)
 {
   if (cmd->has_callback)
@@ -802,7 +886,15 @@ void editorRegisterCommands(void)
   INIT_CONVAR(ex_show_hidden);
   INIT_CONVAR(newline_default);
   INIT_CONVAR(ttimeoutlen);
+  INIT_CONVAR(input_budget);
+  INIT_CONVAR(undo_merge);
+  INIT_CONVAR(undo_word);
+  INIT_CONVAR(undo_budget);
+  INIT_CONVAR(undo_file);
+  INIT_CONVAR(swap_file);
+  INIT_CONVAR(swap_sync);
   INIT_CONVAR(lilx);
+  INIT_CONVAR(hl_window);
 
   INIT_CONCOMMAND(color);
   INIT_CONCOMMAND(lang);
@@ -819,6 +911,8 @@ void editorRegisterCommands(void)
   INIT_CONCOMMAND(help);
   INIT_CONCOMMAND(find);
   INIT_CONCOMMAND(version);
+  INIT_CONCOMMAND(stats);
+  INIT_CONCOMMAND(undo_stats);
 
 #ifdef _DEBUG
   INIT_CONCOMMAND(crash);
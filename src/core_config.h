@@ -85,6 +85,30 @@ typedef struct EditorColorScheme
 
 extern const EditorColorScheme color_default;
 
+// Number of colors in EditorColorScheme
+#define EDITOR_COLOR_SLOTS ((int) (sizeof(EditorColorScheme) / sizeof(Color)))
+
+/**
+ * COLOR_SLOT - Palette slot of a color in EditorColorScheme
+ * @field: Member name, e.g. bg or highlightFg[0]
+ */
+#define COLOR_SLOT(field) ((uint8_t) (offsetof(EditorColorScheme, field) / sizeof(Color)))
+
+/**
+ * struct EditorColorSGR - Escape sequences of a palette slot
+ * @fg: Sequence selecting the color as foreground
+ * @bg: Sequence selecting the color as background
+ * @fg_len: Length of @fg
+ * @bg_len: Length of @bg
+ */
+typedef struct EditorColorSGR
+{
+  char    fg[20];
+  char    bg[20];
+  uint8_t fg_len;
+  uint8_t bg_len;
+} EditorColorSGR;
+
 EXTERN_CONVAR(tabsize);
 EXTERN_CONVAR(whitespace);
 EXTERN_CONVAR(autoindent);
@@ -101,7 +125,15 @@ EXTERN_CONVAR(ex_default_width);
 EXTERN_CONVAR(ex_show_hidden);
 EXTERN_CONVAR(newline_default);
 EXTERN_CONVAR(ttimeoutlen);
+EXTERN_CONVAR(input_budget);
+EXTERN_CONVAR(undo_merge);
+EXTERN_CONVAR(undo_word);
+EXTERN_CONVAR(undo_budget);
+EXTERN_CONVAR(undo_file);
+EXTERN_CONVAR(swap_file);
+EXTERN_CONVAR(swap_sync);
 EXTERN_CONVAR(lilx);
+EXTERN_CONVAR(hl_window);
 
 void editorRegisterCommands(void);
 void editorUnregisterCommands(void);
@@ -109,6 +141,7 @@ bool editorLoadConfig(const char *path);
 void editorLoadInitConfig(void);
 void editorCmd(const char *command);
 void editorOpenConfigPrompt(void);
+void editorUpdateColorSGR(void);
 
 void          editorSetConVar(EditorConVar *thisptr, const char *string_val, bool trigger_cb);
 void          editorInitConCmd(EditorConCmd *thisptr);
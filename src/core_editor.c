@@ -1,9 +1,13 @@
 #include "core_editor.h"
 
 #include "core_config.h"
+#include "core_file_io.h"
 #include "core_highlight.h"
 #include "core_os.h"
+#include "core_output.h"
 #include "core_prompt.h"
+#include "core_screen.h"
+#include "core_task.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +22,7 @@ void editorInit(void)
   gEditor.mouse_mode = true;
 
   gEditor.color_cfg = color_default;
+  editorUpdateColorSGR();
 
   gEditor.con_front = -1;
 
@@ -41,7 +46,10 @@ void editorFree(void)
   editorFreeClipboardContent(&gEditor.clipboard);
   editorExplorerFree();
   editorFreeHLDB();
+  editorScreenFree();
+  editorFreeOutput();
   editorUnregisterCommands();
+  editorFreeTasks();
 }
 
 void editorInitFile(EditorFile *file)
@@ -52,11 +60,15 @@ void editorInitFile(EditorFile *file)
 
 void editorFreeFile(EditorFile *file)
 {
+  editorWaitSave(file);
   for (int i = 0; i < file->num_rows; i++)
   {
-    editorFreeRow(&file->row[i]);
+    editorFreeRow(file, &file->row[i]);
   }
-  editorFreeActionList(file->action_head);
+  editorCloseUndoLog(file);
+  editorReleaseRowIndex(file->index);
+  free(file->snapshots.data);
+  free(file->retired.data);
   free(file->row);
   free(file->filename);
 }
@@ -71,9 +83,10 @@ int editorAddFile(const EditorFile *file)
 
   EditorFile *current = &gEditor.files[gEditor.file_count];
 
-  *current                = *file;
-  current->action_head    = calloc_s(1, sizeof(EditorActionList));
-  current->action_current = current->action_head;
+  *current = *file;
+  memset(&current->undo, 0, sizeof(EditorUndoLog));
+  editorLoadUndoLog(current);
+  editorRecoverSwap(current);
 
   gEditor.file_count++;
   return gEditor.file_count - 1;
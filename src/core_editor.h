@@ -55,6 +55,7 @@ enum EditorState
   OPEN_FILE_MODE,    // File open dialog mode
   CONFIG_MODE,       // Settings/configuration mode
   SAVE_AS_MODE,      // Save file with new name dialog
+  CONFIRM_MODE,      // Yes or no question
 };
 
 /*
@@ -107,9 +108,11 @@ typedef struct EditorFile
    * num_rows: Total number of lines in the file
    * licore_width: Width of line number column (e.g., 5 chars for line "99999")
    *              Name suggests "Line Index Width"
+   * bytes: Bytes in all rows, newlines not counted
    */
-  int num_rows;
-  int licore_width;
+  int    num_rows;
+  int    licore_width;
+  size_t bytes;
 
   /*
    * Line Ending Type
@@ -148,17 +151,29 @@ typedef struct EditorFile
 
   /*
    * Undo/Redo System
-   * dirty: Change counter - increments with edits, decrements with undo
-   *        Zero means file matches saved version on disk
-   * action_head: Start of doubly-linked list of all edit actions
-   * action_current: Current position in undo/redo list
-   * 
-   * Example: [Create]<->[Type "hi"]<->[Delete char]<-current
+   * dirty: Non-zero if the content differs from the version on disk,
+   *        checked against its content hash after every change
+   * undo: Byte log of all edit actions and the current position in it
+   *
+   * Example: [Type "hi"][Delete char]|<-current
    *          Undo moves current left, Redo moves current right
    */
-  int               dirty;
-  EditorActionList *action_head;
-  EditorActionList *action_current;
+  int           dirty;
+  EditorUndoLog undo;
+
+  /*
+   * Snapshots
+   * index: Data and size of every row, shared with the snapshots
+   * gen: Generation of the newest snapshot, 0 before the first one
+   * snapshots: Snapshots that are alive, oldest first
+   * retired: Row buffers the snapshots may still read
+   * save: The background save in progress, NULL if none (see file_io.c)
+   */
+  EditorRowIndex *index;
+  uint32_t        gen;
+  VECTOR(EditorSnapshot *) snapshots;
+  VECTOR(EditorRetiredRow) retired;
+  struct EditorSaveJob *save;
 } EditorFile;
 
 /*
@@ -209,8 +224,11 @@ typedef struct Editor
    * Color Theme
    * color_cfg: Current color scheme (syntax colors, UI colors, background)
    * Structure defined in config.h, allows switching between themes
+   * color_sgr: Escape sequences of every color in color_cfg, indexed by
+   *            COLOR_SLOT(), rebuilt by editorUpdateColorSGR()
    */
   EditorColorScheme color_cfg;
+  EditorColorSGR    color_sgr[EDITOR_COLOR_SLOTS];
 
   /*
    * Console Commands (ConCmd)
@@ -281,6 +299,16 @@ typedef struct Editor
    */
   char prompt[EDITOR_PROMPT_LENGTH];
   char prompt_right[EDITOR_RIGHT_PROMPT_LENGTH];
+
+  /*
+   * Search Highlight
+   * find_query: Query of the active find prompt, NULL when not searching
+   *             Owned by the find callback, read by the renderer to mark
+   *             every visible match (no highlight bytes are modified)
+   * find_ignore_case: Case mode resolved for find_query (smart case applied)
+   */
+  const char *find_query;
+  bool        find_ignore_case;
 } Editor;
 
 /*
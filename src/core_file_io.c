@@ -6,10 +6,19 @@
 #include "core_output.h"
 #include "core_prompt.h"
 #include "core_row.h"
+#include "core_task.h"
+#include "core_terminal.h"
 
 #include <errno.h>
 #include <fcntl.h>
 
+// Chunks collected before each write when saving, a row and its newline
+// take two
+#define SAVE_BATCH_SIZE 1024
+
+// Progress of a background save is redrawn at most this often
+#define SAVE_PROGRESS_MS 100
+
 static int isFileOpened(FileInfo info)
 {
   for (int i = 0; i < gEditor.file_count; i++)
@@ -22,37 +31,126 @@ static int isFileOpened(FileInfo info)
   return -1;
 }
 
-static char *editroRowsToString(EditorFile *file, size_t *len)
+/**
+ * struct EditorSaveJob - A save running on a worker thread
+ * @task: The task writing the file
+ * @snapshot: Content being written
+ * @path: Where the content is written
+ * @total: Bytes to write
+ * @written: Bytes written so far, updated by the worker
+ * @ok: Whether the write succeeded, valid once @task finished
+ * @error: errno of a failed write
+ * @hash: Content hash of @snapshot, valid if @ok
+ * @shown: Progress last shown in the status bar
+ */
+typedef struct EditorSaveJob
 {
-  size_t total_len = 0;
-  int    nl_len    = (file->newline == NL_UNIX) ? 1 : 2;
-  for (int i = 0; i < file->num_rows; i++)
-  {
-    total_len += file->row[i].size + nl_len;
-  }
+  EditorTask      task;
+  EditorSnapshot *snapshot;
+  char           *path;
+  int64_t         total;
+  int64_t         written;
+  bool            ok;
+  int             error;
+  uint64_t        hash;
+  int             shown;
+} EditorSaveJob;
+
+/**
+ * editorWriteSnapshot - Write the content of a save to its path
+ * @job: The save
+ *
+ * Rows are written straight from the snapshot, joined with the newline of
+ * the file, a batch of them per write call.
+ *
+ * Returns: false on error, errno is set
+ */
+static bool editorWriteSnapshot(EditorSaveJob *job)
+{
+  const EditorSnapshot *snapshot = job->snapshot;
+  const EditorRowIndex *index    = snapshot->index;
+
+  FileWriter writer;
+  if (!writerOpen(&writer, job->path))
+    return false;
 
-  // last line no newline
-  *len = (total_len > 0) ? total_len - nl_len : 0;
+  Str newline = {
+      .data = snapshot->newline == NL_DOS ? "\r\n" : "\n",
+      .size = snapshot->newline == NL_DOS ? 2 : 1,
+  };
 
-  char *buf = malloc_s(total_len);
-  char *p   = buf;
-  for (int i = 0; i < file->num_rows; i++)
+  Str     chunks[SAVE_BATCH_SIZE];
+  int     count   = 0;
+  int64_t written = 0;
+
+  int i = 0;
+  for (int n = 0; n < index->num_chunks; n++)
   {
-    memcpy(p, file->row[i].data, file->row[i].size);
-    p += file->row[i].size;
-    if (i != file->num_rows - 1)
+    const EditorRowChunk *rows = index->chunks[n];
+    for (int j = 0; j < rows->count; j++, i++)
     {
-      if (file->newline == NL_DOS)
+      if (rows->rows[j].size)
+        chunks[count++] = rows->rows[j];
+
+      // last line no newline
+      if (i != snapshot->num_rows - 1)
+        chunks[count++] = newline;
+
+      if (count >= SAVE_BATCH_SIZE - 1 || i == snapshot->num_rows - 1)
       {
-        *p = '\r';
-        p++;
+        if (!writerWrite(&writer, chunks, count))
+        {
+          writerAbort(&writer);
+          return false;
+        }
+        for (int k = 0; k < count; k++)
+          written += chunks[k].size;
+        atomicStore(&job->written, written);
+        count = 0;
       }
-      *p = '\n';
-      p++;
     }
   }
 
-  return buf;
+  return writerCommit(&writer);
+}
+
+static void editorSaveRun(void *arg)
+{
+  EditorSaveJob *job = arg;
+
+  job->ok    = editorWriteSnapshot(job);
+  job->error = errno;
+  if (job->ok)
+    job->hash = editorHashSnapshot(job->snapshot);
+}
+
+// Clean up a save that was written, on the main thread
+static void editorSaveDone(void *arg)
+{
+  EditorSaveJob *job  = arg;
+  EditorFile    *file = NULL;
+
+  // Files move around in gEditor.files as others are closed
+  for (int i = 0; i < gEditor.file_count; i++)
+  {
+    if (gEditor.files[i].save == job)
+    {
+      file = &gEditor.files[i];
+      break;
+    }
+  }
+
+  editorEndUndoSave(file, job->ok ? job->snapshot : NULL, job->hash);
+  editorReleaseSnapshot(file, job->snapshot);
+
+  if (job->ok)
+    editorMsg("%zu bytes written to disk.", (size_t) job->total);
+  else
+    editorMsg("Can't save \"%s\"! %s", job->path, strerror(job->error));
+
+  free(job->path);
+  free(job);
+  file->save = NULL;
 }
 
 static void editorExplorerFreeNode(EditorExplorerNode *node)
@@ -182,6 +280,19 @@ bool editorOpen(EditorFile *file, const char *path)
 
   while ((len = getLine(&line, &n, fp)) != -1)
   {
+    if (editorCheckCancel())
+    {
+      editorMsg("Loading \"%s\" canceled.", path);
+      for (int i = 0; i < file->num_rows; i++)
+        editorFreeRow(file, &file->row[i]);
+      editorReleaseRowIndex(file->index);
+      free(file->row);
+      free(file->filename);
+      free(line);
+      fclose(fp);
+      return false;
+    }
+
     has_end_nl = false;
     while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
     {
@@ -223,6 +334,9 @@ bool editorOpen(EditorFile *file, const char *path)
 
 bool editorSave(EditorFile *file, int save_as)
 {
+  // One save of a file at a time
+  editorWaitSave(file);
+
   if (!file->filename || save_as)
   {
     char        prompt_buf[64];
@@ -244,8 +358,8 @@ bool editorSave(EditorFile *file, int save_as)
       return false;
     }
 
-    // Check path is valid
-    FILE *fp = openFile(path, "wb");
+    // Check path is valid, without truncating an existing file
+    FILE *fp = openFile(path, "ab");
     if (!fp)
     {
       editorMsg("Can't save \"%s\"! %s", path, strerror(errno));
@@ -262,25 +376,73 @@ bool editorSave(EditorFile *file, int save_as)
     editorSelectSyntaxHighlight(file);
   }
 
-  size_t len;
-  char  *buf = editroRowsToString(file, &len);
+  EditorSaveJob *job = malloc_s(sizeof(EditorSaveJob));
+  memset(job, 0, sizeof(EditorSaveJob));
+  job->snapshot = editorTakeSnapshot(file);
+  job->shown    = -1;
+
+  size_t path_len = strlen(file->filename) + 1;
+  job->path       = malloc_s(path_len);
+  memcpy(job->path, file->filename, path_len);
+
+  int newline_len = (file->newline == NL_DOS) ? 2 : 1;
+  job->total      = file->bytes;
+  if (file->num_rows)
+    job->total += (int64_t) newline_len * (file->num_rows - 1);
 
-  FILE *fp = openFile(file->filename, "wb");
-  if (fp)
+  // The file counts as saved while it is written, edits made in the
+  // meantime are compared with the disk once it is done
+  file->dirty = 0;
+  editorBeginUndoSave(file);
+  file->save = job;
+
+  job->task.run  = editorSaveRun;
+  job->task.done = editorSaveDone;
+  job->task.arg  = job;
+  editorStartTask(&job->task);
+  return true;
+}
+
+void editorWaitSave(EditorFile *file)
+{
+  if (file->save)
+    editorWaitTask(&file->save->task);
+}
+
+int editorPollSaves(void)
+{
+  bool running = false;
+  bool redraw  = false;
+
+  for (int i = 0; i < gEditor.file_count; i++)
   {
-    if (fwrite(buf, sizeof(char), len, fp) == len)
-    {
-      fclose(fp);
-      free(buf);
-      file->dirty = 0;
-      editorMsg("%d bytes written to disk.", len);
-      return true;
-    }
-    fclose(fp);
+    EditorFile    *file = &gEditor.files[i];
+    EditorSaveJob *job  = file->save;
+    if (!job)
+      continue;
+
+    // Finished saves are cleaned up by their task
+    running     = true;
+    int percent = editorSaveProgress(file);
+    if (file == gCurFile && job->shown != percent)
+      redraw = true;
+    job->shown = percent;
   }
-  free(buf);
-  editorMsg("Can't save \"%s\"! %s", file->filename, strerror(errno));
-  return false;
+
+  if (redraw)
+    editorRefreshScreen();
+
+  return running ? SAVE_PROGRESS_MS : READ_WAIT_INFINITE;
+}
+
+int editorSaveProgress(const EditorFile *file)
+{
+  const EditorSaveJob *job = file->save;
+  if (!job)
+    return -1;
+
+  int64_t written = atomicLoad(&job->written);
+  return job->total ? (int) (written * 100 / job->total) : 100;
 }
 
 void editorOpenFilePrompt(void)
@@ -365,6 +527,23 @@ void editorExplorerLoadNode(EditorExplorerNode *node)
 
   do
   {
+    if (editorCheckCancel())
+    {
+      // Leave the directory closed and unloaded
+      editorMsg("Loading \"%s\" canceled.", node->filename);
+      dirClose(&iter);
+      for (size_t i = 0; i < node->dir.count; i++)
+        editorExplorerFreeNode(node->dir.nodes[i]);
+      for (size_t i = 0; i < node->file.count; i++)
+        editorExplorerFreeNode(node->file.nodes[i]);
+      free(node->dir.nodes);
+      free(node->file.nodes);
+      node->dir     = (EditorExplorerNodeData) {0};
+      node->file    = (EditorExplorerNodeData) {0};
+      node->is_open = false;
+      return;
+    }
+
     const char *filename = dirGetName(&iter);
     if (CONVAR_GETINT(ex_show_hidden) == 0 && filename[0] == '.')
       continue;
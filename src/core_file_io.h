@@ -35,6 +35,9 @@ typedef struct EditorFile EditorFile;
 
 bool editorOpen(EditorFile *file, const char *filename);
 bool editorSave(EditorFile *file, int save_as);
+void editorWaitSave(EditorFile *file);
+int  editorPollSaves(void);
+int  editorSaveProgress(const EditorFile *file);
 void editorOpenFilePrompt(void);
 
 EditorExplorerNode *editorExplorerCreate(const char *path);
@@ -4,6 +4,7 @@
 #include "core_config.h"
 #include "core_editor.h"
 #include "core_os.h"
+#include "core_terminal.h"
 
 #include <ctype.h>
 
@@ -12,37 +13,135 @@
 #define JSON_MALLOC malloc_s
 #include "core_json.h"
 
+// Scratch buffer the lexer writes one class per byte into before compressing
+static uint8_t *hl_scratch          = NULL;
+static size_t   hl_scratch_capacity = 0;
+
 /**
- * editorUpdateSyntax - Update syntax highlighting for a single row
- * @file: The file containing the row
- * @row: The row to update highlighting for
- * 
- * Performs syntax highlighting on a single line based on the file's
- * syntax definition. Handles:
- * - Single-line comments
- * - Multi-line comments (with state tracking across lines)
- * - String literals (with escape sequences)
- * - Numbers (decimal, hex, octal, float)
- * - Keywords (3 categories)
- * - Trailing whitespace
- * 
- * The function uses a state machine approach and may recursively
- * update the next line if multi-line comment state changes.
+ * editorHighlightScratch - Get the per-byte scratch buffer
+ * @size: Number of bytes needed
+ *
+ * Returns: Buffer of at least @size bytes, valid until the next call
  */
-void editorUpdateSyntax(EditorFile *file, EditorRow *row)
+static uint8_t *editorHighlightScratch(size_t size)
 {
-  if (row->hl)
+  if (size > hl_scratch_capacity)
   {
-    // Reset all highlighting to normal
-    // Note: realloc might return NULL when row->size == 0
-    memset(row->hl, HL_NORMAL, row->size);
+    hl_scratch_capacity = hl_scratch_capacity ? hl_scratch_capacity : 256;
+    while (hl_scratch_capacity < size)
+      hl_scratch_capacity *= 2;
+    hl_scratch = realloc_s(hl_scratch, hl_scratch_capacity);
   }
+  return hl_scratch;
+}
 
-  EditorSyntax *s = file->syntax;
+/**
+ * editorHighlightCompress - Store per-byte classes as runs in a row
+ * @row: Row to store the runs in
+ * @hl: One class per byte, indexed by byte position in the row
+ * @start: First byte of @hl to store
+ * @end: One past the last byte of @hl to store
+ *
+ * Consecutive bytes of the same class are packed into a single run,
+ * see HL_RUN_MAKE(). Bytes before @start are stored as HL_NORMAL and
+ * nothing is stored after @end. The run array is sized exactly to fit.
+ */
+static void editorHighlightCompress(EditorRow *row, const uint8_t *hl, int start, int end)
+{
+  int runs = (start + HL_RUN_MAX_LEN - 1) / HL_RUN_MAX_LEN;
+  for (int i = start; i < end; runs++)
+  {
+    int j = i + 1;
+    while (j < end && hl[j] == hl[i] && j - i < HL_RUN_MAX_LEN)
+      j++;
+    i = j;
+  }
 
-  // Skip if syntax highlighting is disabled or no syntax defined
-  if (!CONVAR_GETINT(syntax) || !s)
-    goto update_trailing;
+  if (runs == 0)
+  {
+    free(row->hl);
+    row->hl = NULL;
+  }
+  else if (runs != row->hl_runs)
+  {
+    row->hl = realloc_s(row->hl, sizeof(uint16_t) * runs);
+  }
+  row->hl_runs = runs;
+
+  runs = 0;
+  for (int i = 0; i < start; runs++)
+  {
+    int len = (start - i < HL_RUN_MAX_LEN) ? start - i : HL_RUN_MAX_LEN;
+    row->hl[runs] = HL_RUN_MAKE(HL_NORMAL, len);
+    i += len;
+  }
+  for (int i = start; i < end; runs++)
+  {
+    int j = i + 1;
+    while (j < end && hl[j] == hl[i] && j - i < HL_RUN_MAX_LEN)
+      j++;
+    row->hl[runs] = HL_RUN_MAKE(hl[i], j - i);
+    i = j;
+  }
+}
+
+/**
+ * struct EditorHighlightState - Lexer state between two tokens
+ * @pos: Byte index of the next token
+ * @in_comment: Inside a multi-line comment
+ * @in_string: Inside a string (stores the opening quote char)
+ * @prev_sep: Previous character was a separator
+ */
+typedef struct EditorHighlightState
+{
+  int pos;
+  int in_comment;
+  int in_string;
+  int prev_sep;
+} EditorHighlightState;
+
+/**
+ * struct EditorHighlightWindow - Partial highlighting state of a long row
+ * @start: First highlighted byte
+ * @end: One past the last highlighted byte
+ * @open_comment: Multi-line comment state the checkpoints were built from
+ * @checkpoints: Lexer states every HL_CHECKPOINT_INTERVAL bytes, sorted
+ *
+ * Rows longer than the hl_window cvar are only highlighted in a window
+ * around the visible columns. Lexing resumes from the nearest checkpoint
+ * instead of the start of the row, so moving the window is cheap.
+ */
+struct EditorHighlightWindow
+{
+  int start;
+  int end;
+  int open_comment;
+  VECTOR(EditorHighlightState) checkpoints;
+};
+
+// Bytes between two lexer checkpoints of a long row
+#define HL_CHECKPOINT_INTERVAL 1024
+// Keywords and delimiters are matched by looking ahead of the lexer position,
+// so checkpoints this close before an edit can be affected by it too
+#define HL_CHECKPOINT_SLACK 64
+
+/**
+ * editorHighlightLex - Run the lexer over part of a row
+ * @file: The file containing the row
+ * @row: The row to highlight
+ * @hl: Output, one class per byte indexed by byte position in the row
+ * @state: State to start from, updated to the state where lexing stopped
+ * @end: Stop before the first token starting at or after this byte
+ * @window: Window to record checkpoints into, NULL for short rows
+ *
+ * Bytes of @hl not covered by a token are left untouched. Tokens crossing
+ * @end are written completely, so @hl must hold row->size bytes.
+ */
+static void editorHighlightLex(EditorFile *file, EditorRow *row, uint8_t *hl,
+                               EditorHighlightState *state, int end,
+                               struct EditorHighlightWindow *window)
+{
+  EditorSyntax *s = file->syntax;
 
   // Get comment delimiters from syntax definition
   const char *scs = s->singleline_comment_start;
@@ -54,23 +153,36 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
   int mce_len = mce ? strlen(mce) : 0;
 
   // State variables for syntax highlighting
-  int prev_sep   = 1;  // Previous character was a separator
-  int in_string  = 0;  // Currently inside a string (stores opening quote char)
-  int row_index  = (int) (row - file->row);
-  int in_comment = (row_index > 0 && file->row[row_index - 1].hl_open_comment);
+  int prev_sep   = state->prev_sep;
+  int in_string  = state->in_string;
+  int in_comment = state->in_comment;
 
-  int i = 0;
-  while (i < row->size)
+  int i = state->pos;
+  while (i < end)
   {
     char c = row->data[i];
 
+    // Remember the state every HL_CHECKPOINT_INTERVAL bytes
+    if (window)
+    {
+      int last = window->checkpoints.size
+                     ? window->checkpoints.data[window->checkpoints.size - 1].pos
+                     : 0;
+      if (i >= last + HL_CHECKPOINT_INTERVAL)
+      {
+        EditorHighlightState checkpoint = {i, in_comment, in_string, prev_sep};
+        vector_push(window->checkpoints, checkpoint);
+      }
+    }
+
     // Handle single-line comments
     if (scs_len && !in_string && !in_comment)
     {
       if (i + scs_len <= row->size && strncmp(&row->data[i], scs, scs_len) == 0)
       {
         // Rest of line is a comment
-        memset(&row->hl[i], HL_COMMENT, row->size - i);
+        memset(&hl[i], HL_COMMENT, end - i);
+        i = end;
         break;
       }
     }
@@ -81,11 +193,11 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
       if (in_comment)
       {
         // Currently inside a multi-line comment
-        row->hl[i] = HL_COMMENT;
+        hl[i] = HL_COMMENT;
         if (i + mce_len <= row->size && strncmp(&row->data[i], mce, mce_len) == 0)
         {
           // Found comment end delimiter
-          memset(&row->hl[i], HL_COMMENT, mce_len);
+          memset(&hl[i], HL_COMMENT, mce_len);
           i += mce_len;
           in_comment = 0;
           prev_sep   = 1;
@@ -96,7 +208,7 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
       else if (i + mcs_len <= row->size && strncmp(&row->data[i], mcs, mcs_len) == 0)
       {
         // Found comment start delimiter
-        memset(&row->hl[i], HL_COMMENT, mcs_len);
+        memset(&hl[i], HL_COMMENT, mcs_len);
         i += mcs_len;
         in_comment = 1;
         continue;
@@ -108,12 +220,12 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
     {
       if (in_string)
       {
-        row->hl[i] = HL_STRING;
+        hl[i] = HL_STRING;
         
         // Handle escape sequences
         if (c == '\\' && i + 1 < row->size)
         {
-          row->hl[i + 1] = HL_STRING;
+          hl[i + 1] = HL_STRING;
           i += 2;
           continue;
         }
@@ -129,7 +241,7 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
       {
         // Start of string
         in_string  = c;
-        row->hl[i] = HL_STRING;
+        hl[i] = HL_STRING;
         i++;
         continue;
       }
@@ -208,7 +320,7 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
           
         // Only highlight if followed by separator or whitespace
         if (i == row->size || isSeparator(row->data[i]) || isSpace(row->data[i]))
-          memset(&row->hl[start], HL_NUMBER, i - start);
+          memset(&hl[start], HL_NUMBER, i - start);
         prev_sep = 0;
         continue;
       }
@@ -232,7 +344,7 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
               (i + klen == row->size || isNonIdentifierChar(row->data[i + klen])))
           {
             found_keyword = true;
-            memset(&row->hl[i], keyword_type, klen);
+            memset(&hl[i], keyword_type, klen);
             i += klen;
             break;
           }
@@ -255,27 +367,258 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row)
     i++;
   }
   
-  // Update multi-line comment state
-  int changed          = (row->hl_open_comment != in_comment);
-  row->hl_open_comment = in_comment;
-  
-  // Recursively update next line if comment state changed
-  if (changed && row_index + 1 < file->num_rows)
-    editorUpdateSyntax(file, &file->row[row_index + 1]);
 
-  // Highlight trailing whitespace
-update_trailing:
-  for (i = row->size - 1; i >= 0; i--)
+  state->pos        = i;
+  state->in_comment = in_comment;
+  state->in_string  = in_string;
+  state->prev_sep   = prev_sep;
+}
+
+/**
+ * editorHighlightInitialState - Get the lexer state at the start of a row
+ * @file: The file containing the row
+ * @row: The row
+ *
+ * Returns: State continuing the multi-line comment of the previous row
+ */
+static EditorHighlightState editorHighlightInitialState(EditorFile *file, EditorRow *row)
+{
+  int                  row_index = (int) (row - file->row);
+  EditorHighlightState state     = {
+          .pos        = 0,
+          .in_comment = (row_index > 0 && file->row[row_index - 1].hl_open_comment),
+          .in_string  = 0,
+          .prev_sep   = 1,
+  };
+  return state;
+}
+
+/**
+ * editorHighlightFreeWindow - Go back to highlighting the whole row
+ * @row: The row
+ */
+static void editorHighlightFreeWindow(EditorRow *row)
+{
+  if (!row->hl_window)
+    return;
+
+  free(row->hl_window->checkpoints.data);
+  free(row->hl_window);
+  row->hl_window = NULL;
+}
+
+/**
+ * editorHighlightWindow - Highlight the part of a long row around a range
+ * @file: The file containing the row
+ * @row: The row to highlight
+ * @start: First byte that must be highlighted
+ * @end: One past the last byte that must be highlighted
+ *
+ * The range is widened by HL_CHECKPOINT_INTERVAL bytes on both sides so
+ * small horizontal scrolls don't need to lex again. Bytes outside the
+ * window are stored as HL_NORMAL.
+ *
+ * The first call lexes the whole row once. After that, the multi-line
+ * comment state at the end of the row is only known when the window
+ * reaches the end of the row. Otherwise hl_open_comment keeps its
+ * previous value, so a comment opened or closed by an edit far to the
+ * left of the row end only reaches the following rows once the end is
+ * visible again.
+ *
+ * Returns: true if hl_open_comment changed
+ */
+static bool editorHighlightWindow(EditorFile *file, EditorRow *row, int start, int end)
+{
+  struct EditorHighlightWindow *window = row->hl_window;
+  EditorHighlightState          state  = editorHighlightInitialState(file, row);
+  bool                          first  = !window;
+
+  if (!window)
   {
-    if (row->data[i] == ' ' || row->data[i] == '\t')
-    {
-      row->hl[i] = HL_BG_TRAILING << HL_FG_BITS;
-    }
+    window               = calloc_s(1, sizeof(struct EditorHighlightWindow));
+    window->open_comment = state.in_comment;
+    row->hl_window       = window;
+  }
+
+  // Checkpoints depend on how the row starts
+  if (window->open_comment != state.in_comment)
+  {
+    window->checkpoints.size = 0;
+    window->open_comment     = state.in_comment;
+  }
+
+  start = (start > HL_CHECKPOINT_INTERVAL) ? start - HL_CHECKPOINT_INTERVAL : 0;
+  end   = (end < row->size - HL_CHECKPOINT_INTERVAL) ? end + HL_CHECKPOINT_INTERVAL : row->size;
+
+  // Resume from the last checkpoint at or before the window
+  size_t lo = 0;
+  size_t hi = window->checkpoints.size;
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    if (window->checkpoints.data[mid].pos <= start)
+      lo = mid + 1;
     else
-    {
-      break;
-    }
+      hi = mid;
   }
+  if (lo > 0)
+    state = window->checkpoints.data[lo - 1];
+
+  // The first time, lex the whole row to place all checkpoints and to
+  // know the comment state at the end
+  int lex_end = first ? row->size : end;
+
+  uint8_t *hl = editorHighlightScratch(row->size);
+  memset(&hl[state.pos], HL_NORMAL, lex_end - state.pos);
+  editorHighlightLex(file, row, hl, &state, lex_end, window);
+  editorHighlightCompress(row, hl, start, end);
+
+  window->start = start;
+  window->end   = end;
+
+  if (lex_end < row->size)
+    return false;
+
+  int changed          = (row->hl_open_comment != state.in_comment);
+  row->hl_open_comment = state.in_comment;
+  return changed;
+}
+
+/**
+ * editorHighlightRow - Update syntax highlighting for a single row
+ * @file: The file containing the row
+ * @row: The row to update highlighting for
+ *
+ * Returns: true if the multi-line comment state at the end changed
+ */
+static bool editorHighlightRow(EditorFile *file, EditorRow *row)
+{
+  uint8_t *hl;
+
+  // Skip if syntax highlighting is disabled or no syntax defined
+  if (!CONVAR_GETINT(syntax) || !file->syntax)
+  {
+    editorHighlightFreeWindow(row);
+    hl = editorHighlightScratch(row->size);
+    memset(hl, HL_NORMAL, row->size);
+    editorHighlightCompress(row, hl, 0, row->size);
+    return false;
+  }
+
+  // Long row, only highlight around the visible columns
+  int limit = CONVAR_GETINT(hl_window);
+  if (limit > 0 && row->size > limit)
+  {
+    int start = editorRowRxToCx(row, file->col_offset);
+    int end   = editorRowRxToCx(row, file->col_offset + gEditor.screen_cols);
+    return editorHighlightWindow(file, row, start, end + 1);
+  }
+  editorHighlightFreeWindow(row);
+
+  EditorHighlightState state = editorHighlightInitialState(file, row);
+
+  hl = editorHighlightScratch(row->size);
+  memset(hl, HL_NORMAL, row->size);
+  editorHighlightLex(file, row, hl, &state, row->size, NULL);
+  editorHighlightCompress(row, hl, 0, row->size);
+
+  // Update multi-line comment state
+  int changed          = (row->hl_open_comment != state.in_comment);
+  row->hl_open_comment = state.in_comment;
+  return changed;
+}
+
+/**
+ * editorUpdateSyntax - Update syntax highlighting for a single row
+ * @file: The file containing the row
+ * @row: The row to update highlighting for
+ * 
+ * Performs syntax highlighting on a single line based on the file's
+ * syntax definition. Handles:
+ * - Single-line comments
+ * - Multi-line comments (with state tracking across lines)
+ * - String literals (with escape sequences)
+ * - Numbers (decimal, hex, octal, float)
+ * - Keywords (3 categories)
+ * 
+ * The lexer classifies every byte into a scratch buffer which is then
+ * run-length encoded into row->hl.
+ * 
+ * Only foreground classes are written to row->hl. Backgrounds (selection,
+ * search matches, trailing whitespace) are added at render time by the
+ * overlay layer, see core_overlay.h.
+ * 
+ * When the multi-line comment state at the end of the row changes, the
+ * following rows are updated as well until the state settles.
+ */
+void editorUpdateSyntax(EditorFile *file, EditorRow *row)
+{
+  int at = (int) (row - file->row);
+  while (editorHighlightRow(file, &file->row[at]) && ++at < file->num_rows)
+  {
+  }
+}
+
+void editorUpdateSyntaxRange(EditorFile *file, int start, int end)
+{
+  for (int i = start; i < end; i++)
+    editorHighlightRow(file, &file->row[i]);
+
+  // The row after the range was highlighted with the old comment state
+  if (end > start && end < file->num_rows)
+    editorUpdateSyntax(file, &file->row[end]);
+}
+
+void editorRowInvalidateSyntax(EditorRow *row, int at)
+{
+  if (!row->hl_window)
+    return;
+
+  // Drop the checkpoints the edit can affect
+  struct EditorHighlightWindow *window = row->hl_window;
+  while (window->checkpoints.size &&
+         window->checkpoints.data[window->checkpoints.size - 1].pos + HL_CHECKPOINT_SLACK > at)
+  {
+    window->checkpoints.size--;
+  }
+}
+
+void editorHighlightEnsureVisible(EditorFile *file, EditorRow *row, int start, int end)
+{
+  if (!row->hl_window)
+    return;
+
+  if (start >= row->hl_window->start && end <= row->hl_window->end)
+    return;
+
+  // Reaching the end of the row can reveal a different comment state
+  int at = (int) (row - file->row);
+  if (editorHighlightWindow(file, row, start, end) && at + 1 < file->num_rows)
+    editorUpdateSyntax(file, &file->row[at + 1]);
+}
+
+void editorRowFreeSyntax(EditorRow *row)
+{
+  editorHighlightFreeWindow(row);
+  free(row->hl);
+}
+
+void editorHighlightIterInit(EditorHighlightIter *iter, const EditorRow *row)
+{
+  iter->run  = row->hl;
+  iter->last = row->hl + row->hl_runs;
+  iter->end  = row->hl_runs ? (int) HL_RUN_LEN(row->hl[0]) : 0;
+}
+
+uint8_t editorHighlightIterAt(EditorHighlightIter *iter, int col)
+{
+  while (iter->run < iter->last && iter->end <= col)
+  {
+    iter->run++;
+    if (iter->run < iter->last)
+      iter->end += HL_RUN_LEN(*iter->run);
+  }
+  return (iter->run < iter->last) ? HL_RUN_CLASS(*iter->run) : HL_NORMAL;
 }
 
 /**
@@ -285,14 +628,32 @@ update_trailing:
  * 
  * Sets the syntax definition for a file and updates highlighting
  * for all rows in the file.
+ *
+ * Returns: false if the update was canceled
  */
-void editorSetSyntaxHighlight(EditorFile *file, EditorSyntax *syntax)
+bool editorSetSyntaxHighlight(EditorFile *file, EditorSyntax *syntax)
 {
+  EditorSyntax *old = file->syntax;
+
   file->syntax = syntax;
   for (int i = 0; i < file->num_rows; i++)
   {
+    if (editorCheckCancel())
+    {
+      // Put the rows done so far back the way they were
+      file->syntax = old;
+      for (int j = 0; j < i; j++)
+      {
+        editorRowInvalidateSyntax(&file->row[j], 0);
+        editorUpdateSyntax(file, &file->row[j]);
+      }
+      return false;
+    }
+
+    editorRowInvalidateSyntax(&file->row[i], 0);
     editorUpdateSyntax(file, &file->row[i]);
   }
+  return true;
 }
 
 /**
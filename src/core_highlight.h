@@ -3,22 +3,31 @@
 
 #include "core_utils.h"
 
+#include <limits.h>
+
 // Forward declarations to avoid circular dependencies
 typedef struct EditorFile EditorFile;
 typedef struct EditorRow  EditorRow;
 
 /**
- * Highlight color encoding masks and shifts
+ * Highlight run encoding
  *
- * Each character's highlight is stored as a single byte:
- * - Lower 4 bits (0x0F): Foreground color (text color)
- * - Upper 4 bits (0xF0): Background color (highlight/selection)
+ * EditorRow::hl is run-length encoded: each uint16_t covers a run of
+ * consecutive bytes with the same foreground class.
+ * - Lower 4 bits: Foreground class (enum EditorHighlightFg)
+ * - Upper 12 bits: Number of bytes in the run (1-4095)
  *
- * HL_FG_BITS is used to shift background values into the upper 4 bits.
+ * Longer runs are split, so a row of any size can be encoded. Source code
+ * averages around 10 bytes per run, so this takes about 1/5 of the memory
+ * of one byte per character.
  */
-#define HL_FG_MASK 0x0F  // Mask for foreground color (bits 0-3)
-#define HL_BG_MASK 0xF0  // Mask for background color (bits 4-7)
-#define HL_FG_BITS 4     // Number of bits for foreground (shift amount for background)
+#define HL_RUN_CLASS_BITS 4
+#define HL_RUN_CLASS_MASK 0x0F
+#define HL_RUN_MAX_LEN ((int) (UINT16_MAX >> HL_RUN_CLASS_BITS))
+
+#define HL_RUN_MAKE(cls, len) ((uint16_t) (((len) << HL_RUN_CLASS_BITS) | (cls)))
+#define HL_RUN_CLASS(run) ((uint8_t) ((run) & HL_RUN_CLASS_MASK))
+#define HL_RUN_LEN(run) ((run) >> HL_RUN_CLASS_BITS)
 
 /**
  * Syntax highlighting feature flags
@@ -33,7 +42,7 @@ typedef struct EditorRow  EditorRow;
  * enum EditorHighlightFg - Foreground (text) color types
  *
  * Defines the different syntax element types for foreground coloring.
- * These values occupy the lower 4 bits of the highlight byte.
+ * Stored in the lower 4 bits of each highlight run in EditorRow::hl.
  *
  * @HL_NORMAL: Default text color
  * @HL_COMMENT: Comments (single-line and multi-line)
@@ -62,9 +71,9 @@ enum EditorHighlightFg
 /**
  * enum EditorHighlightBg - Background highlight types
  *
- * Defines the different background highlighting states.
- * These values are shifted left by HL_FG_BITS (4) to occupy
- * the upper 4 bits of the highlight byte.
+ * Defines the different background highlighting states. Backgrounds
+ * are never stored in the row, they come from the overlay spans that
+ * are built for every visible row at render time (see core_overlay.h).
  *
  * @HL_BG_NORMAL: Default background (or current line highlight)
  * @HL_BG_MATCH: Search match highlighting
@@ -129,10 +138,97 @@ typedef struct EditorSyntax
  * syntax definition. This function is called:
  * - When a line is modified
  * - When syntax is changed
- * - Recursively when multi-line comment state changes
+ *
+ * Following lines are updated too while the multi-line comment state
+ * at their end keeps changing.
  */
 void editorUpdateSyntax(EditorFile *file, EditorRow *row);
 
+/**
+ * editorUpdateSyntaxRange - Update syntax highlighting for a range of rows
+ * @file: The file containing the rows
+ * @start: First row to update
+ * @end: One past the last row to update
+ *
+ * Highlights every row of the range once, in order, then continues after
+ * the range only while the multi-line comment state keeps changing. Used
+ * after inserting many rows at once.
+ */
+void editorUpdateSyntaxRange(EditorFile *file, int start, int end);
+
+/**
+ * editorRowInvalidateSyntax - Forget lexer state after a row was modified
+ * @row: The modified row
+ * @at: First byte that changed
+ *
+ * Long rows keep lexer checkpoints along the line (see the hl_window
+ * cvar). Every function that modifies row->data must call this before
+ * updating the row, so highlighting never resumes from a stale state.
+ */
+void editorRowInvalidateSyntax(EditorRow *row, int at);
+
+/**
+ * editorHighlightEnsureVisible - Make sure a byte range of a row is highlighted
+ * @file: The file containing the row
+ * @row: The row about to be drawn
+ * @start: First visible byte
+ * @end: One past the last visible byte
+ *
+ * Long rows are only highlighted in a window around the visible columns.
+ * Called by the renderer, re-highlights the row when the visible range
+ * is not covered by that window any more. Does nothing for other rows.
+ */
+void editorHighlightEnsureVisible(EditorFile *file, EditorRow *row, int start, int end);
+
+/**
+ * editorRowFreeSyntax - Free the highlighting data of a row
+ * @row: The row
+ */
+void editorRowFreeSyntax(EditorRow *row);
+
+/**
+ * struct EditorHighlightIter - Sequential reader of the highlight runs of a row
+ * @run: Current run
+ * @last: One past the last run of the row
+ * @end: Byte index where the current run ends (exclusive)
+ */
+typedef struct EditorHighlightIter
+{
+  const uint16_t *run;
+  const uint16_t *last;
+  int             end;
+} EditorHighlightIter;
+
+/**
+ * editorHighlightIterInit - Start reading the highlight runs of a row
+ * @iter: Iterator to initialize
+ * @row: The row to read
+ */
+void editorHighlightIterInit(EditorHighlightIter *iter, const EditorRow *row);
+
+/**
+ * editorHighlightIterAt - Get the foreground class of a byte
+ * @iter: Iterator started by editorHighlightIterInit()
+ * @col: Byte index in the row
+ *
+ * Must be called with non-decreasing @col. Skipping ahead only walks
+ * the runs in between, so reading a whole row is O(size + runs).
+ *
+ * Returns: Foreground class (enum EditorHighlightFg), HL_NORMAL past the end
+ */
+uint8_t editorHighlightIterAt(EditorHighlightIter *iter, int col);
+
+/**
+ * editorHighlightIterEnd - Get where the current run ends
+ * @iter: Iterator positioned by editorHighlightIterAt()
+ *
+ * Returns: Byte index where the class may change next
+ */
+static inline int editorHighlightIterEnd(const EditorHighlightIter *iter)
+{
+  return (iter->run < iter->last) ? iter->end : INT_MAX;
+}
+
 /**
  * editorSetSyntaxHighlight - Set syntax highlighting for a file
  * @file: The file to set syntax for
@@ -140,8 +236,13 @@ void editorUpdateSyntax(EditorFile *file, EditorRow *row);
  *
  * Assigns a specific syntax definition to a file and updates
  * highlighting for all rows. Use NULL to disable syntax highlighting.
+ *
+ * The update can be canceled with ESC or Ctrl+C, see editorCheckCancel(),
+ * the file then keeps its previous syntax.
+ *
+ * Returns: false if the update was canceled
  */
-void editorSetSyntaxHighlight(EditorFile *file, EditorSyntax *syntax);
+bool editorSetSyntaxHighlight(EditorFile *file, EditorSyntax *syntax);
 
 /**
  * editorSelectSyntaxHighlight - Auto-detect and set syntax for a file
@@ -3,6 +3,7 @@
 #include "core_config.h"
 #include "core_editor.h"
 #include "core_file_io.h"
+#include "core_os.h"
 #include "core_output.h"
 #include "core_prompt.h"
 #include "core_select.h"
@@ -603,6 +604,10 @@ static void editorCloseFile(int index)
     return;
   }
 
+  // A save still running has cleared the dirty flag, a failed one sets it
+  // again
+  editorWaitSave(&gEditor.files[index]);
+
   if (gEditor.files[index].dirty && close_protect != index)
   {
     editorMsg("File has unsaved changes. Press again to close file "
@@ -731,6 +736,13 @@ void editorProcessKeypress(void)
     {
       close_protect = -1;
       editorFreeAction(action);
+      // Let every background save finish before anything is torn down, a
+      // failed save makes the file dirty again
+      for (int i = 0; i < gEditor.file_count; i++)
+      {
+        editorWaitSave(&gEditor.files[i]);
+      }
+
       bool dirty = false;
       for (int i = 0; i < gEditor.file_count; i++)
       {
@@ -747,6 +759,11 @@ void editorProcessKeypress(void)
         quit_protect = false;
         return;
       }
+      // Keep the undo journals for the next session
+      for (int i = 0; i < gEditor.file_count; i++)
+      {
+        editorCloseUndoLog(&gEditor.files[i]);
+      }
 #ifdef _DEBUG
       editorFree();
 #endif
@@ -767,14 +784,14 @@ void editorProcessKeypress(void)
       should_scroll = false;
       if (gCurFile->dirty || !gCurFile->filename)
       {
+        // The save finishes in the background and reports its result
         editorSave(gCurFile, 0);
-        editorMsg("Files saved. Press Enter to continue.");
       }
       else
       {
         editorMsg("No changes need to be saved. Press Enter to continue.");
+        waiting_for_enter_after_save = true;
       }
-      waiting_for_enter_after_save = true;
       editorFreeAction(action);
       return;
     // --- AKHIR MODIFIKASI ---
@@ -937,6 +954,8 @@ void editorProcessKeypress(void)
         break;
       }
 
+      edit->merge = EDIT_MERGE_DELETE;
+
       bool should_delete_bracket =
           gCurFile->bracket_autocomplete &&
           (isCloseBracket(gCurFile->row[gCurFile->cursor.y].data[gCurFile->cursor.x]) ==
@@ -1032,7 +1051,7 @@ void editorProcessKeypress(void)
       {
         getSelectStartEnd(&edit->deleted_range);
         editorCopyText(&edit->deleted_text, edit->deleted_range);
-        editorCopyText(&gEditor.clipboard, edit->deleted_range);
+        editorShareClipboard(&gEditor.clipboard, &edit->deleted_text);
         gEditor.copy_line = false;
         editorDeleteText(edit->deleted_range);
         gCurFile->cursor.is_selected = false;
@@ -1094,7 +1113,17 @@ void editorProcessKeypress(void)
 
       edit->added_range.end_x = gCurFile->cursor.x;
       edit->added_range.end_y = gCurFile->cursor.y;
-      editorCopyText(&edit->added_text, edit->added_range);
+      if (c == PASTE_INPUT)
+      {
+        // The pasted text is exactly what was added, keep it for undo
+        edit->added_text = input.data.paste;
+        memset(&input.data.paste, 0, sizeof(EditorClipboard));
+      }
+      else
+      {
+        // Exactly the clipboard was added, share it with the undo log
+        editorShareClipboard(&edit->added_text, clipboard);
+      }
     }
     break;
 
@@ -1639,6 +1668,10 @@ void editorProcessKeypress(void)
         editorDeleteText(edit->deleted_range);
         gCurFile->cursor.is_selected = false;
       }
+      else
+      {
+        edit->merge = EDIT_MERGE_INSERT;
+      }
 
       int x_offset              = 0;
       edit->added_range.start_x = gCurFile->cursor.x;
@@ -1738,6 +1771,7 @@ void editorProcessKeypress(void)
   if (should_record_action)
   {
     edit->new_cursor = gCurFile->cursor;
+    edit->time       = getTime();
     editorAppendAction(action);
   }
   else
@@ -1750,3 +1784,34 @@ void editorProcessKeypress(void)
   close_protect = -1;
   quit_protect  = true;
 }
+
+static EditorInputStats input_stats;
+
+void editorProcessInput(void)
+{
+  // Wait for the first event
+  editorProcessKeypress();
+  size_t events = 1;
+
+  // Apply everything that is already queued before the next repaint, so
+  // key repeat and mouse/wheel floods don't cost a frame per event
+  int64_t budget = (int64_t) CONVAR_GETINT(input_budget) * 1000;
+  int64_t start  = getTime();
+  while (budget > 0 && (gEditor.file_count || gEditor.explorer.node) && hasConsoleInput() &&
+         getTime() - start < budget)
+  {
+    editorProcessKeypress();
+    events++;
+  }
+
+  input_stats.events += events;
+  input_stats.batches++;
+  input_stats.last_batch = events;
+  if (events > input_stats.max_batch)
+    input_stats.max_batch = events;
+}
+
+const EditorInputStats *editorGetInputStats(void)
+{
+  return &input_stats;
+}
@@ -13,8 +13,19 @@ enum EditorField
   FIELD_ERROR,
 };
 
+typedef struct EditorInputStats
+{
+  size_t events;      // Input events processed
+  size_t batches;     // Repaints caused by input
+  size_t last_batch;  // Events applied before the last repaint
+  size_t max_batch;   // Most events applied before a single repaint
+} EditorInputStats;
+
 void editorMoveCursor(int key);
 void editorProcessKeypress(void);
+void editorProcessInput(void);
+
+const EditorInputStats *editorGetInputStats(void);
 
 void editorScrollToCursor(void);
 void editorScrollToCursorCenter(void);
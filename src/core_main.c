@@ -77,7 +77,7 @@ int main(int argc, char *argv[])
   while (gEditor.file_count || gEditor.explorer.node)
   {
     editorRefreshScreen();
-    editorProcessKeypress();
+    editorProcessInput();
   }
 
 DONE:
@@ -4,15 +4,27 @@
 #include "core_terminal.h"
 #include "core_utils.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
+#include <sys/file.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <termios.h>
 
+// Bytes written to the signal pipe
+#define SIG_PIPE_WINCH 0x01
+#define SIG_PIPE_WAKE 0x02
+
 static int                   sig_rd = -1, sig_wr = -1;
 static volatile sig_atomic_t winch_queued = 0;
+static int                   wake_queued  = 0;
+
+// File mode creation mask, read once since saves run on other threads and
+// umask() can only be read by changing it
+static mode_t file_mask = 022;
 
 static void SIGWINCH_handler(int sig)
 {
@@ -21,7 +33,7 @@ static void SIGWINCH_handler(int sig)
   if (!winch_queued)
   {
     winch_queued    = 1;
-    const uint8_t b = 0x01;
+    const uint8_t b = SIG_PIPE_WINCH;
     UNUSED(write(sig_wr, &b, 1));
   }
 }
@@ -36,6 +48,9 @@ void osInit(void)
   sig_rd = p[0];
   sig_wr = p[1];
 
+  file_mask = umask(0);
+  umask(file_mask);
+
   struct sigaction winch_action = {
       .sa_handler = SIGWINCH_handler,
   };
@@ -71,8 +86,41 @@ void disableRawMode(void)
   UNUSED(tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios));
 }
 
-static bool readConsoleByte(uint8_t *out, int timeout_ms)
+// Bytes read from the terminal but not consumed yet
+#define INPUT_BUF_SIZE 65536
+
+static struct
+{
+  uint8_t data[INPUT_BUF_SIZE];
+  size_t  start;
+  size_t  end;
+} input_buf;
+
+static void readSignalPipe(void)
 {
+  uint8_t buf[64];
+  ssize_t n = read(sig_rd, buf, sizeof(buf));
+
+  // A wake only ends the wait, whoever called wakeConsole() has its own
+  // queue that is checked after every wait
+  __atomic_store_n(&wake_queued, 0, __ATOMIC_RELEASE);
+
+  for (ssize_t i = 0; i < n; i++)
+  {
+    if (buf[i] == SIG_PIPE_WINCH)
+    {
+      resizeWindow();
+      winch_queued = 0;
+      break;
+    }
+  }
+}
+
+static bool fillInputBuffer(int timeout_ms)
+{
+  if (input_buf.start < input_buf.end)
+    return true;
+
   struct pollfd fds[2] = {
       {.fd = STDIN_FILENO, .events = POLLIN},
       {.fd = sig_rd, .events = POLLIN},
@@ -81,20 +129,66 @@ static bool readConsoleByte(uint8_t *out, int timeout_ms)
   while (true)
   {
     int ret = poll(fds, 2, timeout_ms);
-    if (ret < 0)
+    if (ret <= 0)
       return false;
 
     if (fds[0].revents & POLLIN)
-      return read(STDIN_FILENO, out, 1) == 1;
-
-    if (fds[1].revents & POLLIN)
     {
-      uint8_t buf[64];
-      UNUSED(read(sig_rd, buf, sizeof(buf)));
-      resizeWindow();
-      winch_queued = 0;
+      // Take everything that is available at once
+      ssize_t n = read(STDIN_FILENO, input_buf.data, INPUT_BUF_SIZE);
+      if (n <= 0)
+        return false;
+
+      input_buf.start = 0;
+      input_buf.end   = (size_t) n;
+      return true;
     }
+
+    if (fds[1].revents & POLLIN)
+      readSignalPipe();
+  }
+}
+
+static bool readConsoleByte(uint8_t *out, int timeout_ms)
+{
+  if (!fillInputBuffer(timeout_ms))
+    return false;
+
+  *out = input_buf.data[input_buf.start++];
+  return true;
+}
+
+size_t peekConsoleBytes(const char **data, int timeout_ms)
+{
+  if (!fillInputBuffer(timeout_ms))
+    return 0;
+
+  *data = (const char *) &input_buf.data[input_buf.start];
+  return input_buf.end - input_buf.start;
+}
+
+size_t pollConsoleBytes(const char **data)
+{
+  size_t size = input_buf.end - input_buf.start;
+  memmove(input_buf.data, &input_buf.data[input_buf.start], size);
+  input_buf.start = 0;
+  input_buf.end   = size;
+
+  struct pollfd fd = {.fd = STDIN_FILENO, .events = POLLIN};
+  if (input_buf.end < INPUT_BUF_SIZE && poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN))
+  {
+    ssize_t n = read(STDIN_FILENO, &input_buf.data[input_buf.end], INPUT_BUF_SIZE - input_buf.end);
+    if (n > 0)
+      input_buf.end += (size_t) n;
   }
+
+  *data = (const char *) input_buf.data;
+  return input_buf.end;
+}
+
+void consumeConsoleBytes(size_t count)
+{
+  input_buf.start += count;
 }
 
 bool readConsole(uint32_t *unicode_out, int timeout_ms)
@@ -150,6 +244,44 @@ bool readConsole(uint32_t *unicode_out, int timeout_ms)
   return true;
 }
 
+bool hasConsoleInput(void)
+{
+  if (input_buf.start < input_buf.end)
+    return true;
+
+  struct pollfd fd = {.fd = STDIN_FILENO, .events = POLLIN};
+  return poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN);
+}
+
+bool waitConsole(int timeout_ms)
+{
+  if (input_buf.start < input_buf.end)
+    return true;
+
+  struct pollfd fds[2] = {
+      {.fd = STDIN_FILENO, .events = POLLIN},
+      {.fd = sig_rd, .events = POLLIN},
+  };
+
+  if (poll(fds, 2, timeout_ms) <= 0)
+    return false;
+
+  if (fds[1].revents & POLLIN)
+    readSignalPipe();
+
+  return fds[0].revents & POLLIN;
+}
+
+void wakeConsole(void)
+{
+  // At most one wake byte is in the pipe, so it can't fill up
+  if (!__atomic_exchange_n(&wake_queued, 1, __ATOMIC_ACQ_REL))
+  {
+    const uint8_t b = SIG_PIPE_WAKE;
+    UNUSED(write(sig_wr, &b, 1));
+  }
+}
+
 int writeConsole(const void *buf, size_t count)
 {
   return write(STDOUT_FILENO, buf, count);
@@ -236,6 +368,37 @@ FILE *openFile(const char *path, const char *mode)
   return fopen(path, mode);
 }
 
+bool makeDir(const char *path)
+{
+  return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+bool removeFile(const char *path)
+{
+  return unlink(path) == 0;
+}
+
+bool syncFile(FILE *fp)
+{
+  if (fflush(fp) != 0)
+    return false;
+#ifdef __APPLE__
+  return fsync(fileno(fp)) == 0;
+#else
+  return fdatasync(fileno(fp)) == 0;
+#endif
+}
+
+bool truncateFile(FILE *fp)
+{
+  return fflush(fp) == 0 && ftruncate(fileno(fp), 0) == 0;
+}
+
+bool lockFile(FILE *fp)
+{
+  return flock(fileno(fp), LOCK_EX | LOCK_NB) == 0;
+}
+
 bool changeDir(const char *path)
 {
   return chdir(path) == 0;
@@ -271,6 +434,159 @@ char *getFullPath(const char *path)
   return resolved_path;
 }
 
+// Keep the owner and permissions of the file being replaced
+static bool copyFileMode(int fd, const char *path)
+{
+  struct stat info;
+  struct stat temp_info;
+  if (stat(path, &info) != 0)
+  {
+    // New file, use the default mode instead of the one of mkstemp
+    return fchmod(fd, 0666 & ~file_mask) == 0;
+  }
+
+  // Replacing the file would break its other hard links
+  if (info.st_nlink > 1 || fstat(fd, &temp_info) != 0)
+    return false;
+
+  if ((info.st_uid != temp_info.st_uid || info.st_gid != temp_info.st_gid) &&
+      fchown(fd, info.st_uid, info.st_gid) != 0)
+    return false;
+
+  return fchmod(fd, info.st_mode & 07777) == 0;
+}
+
+bool writerOpen(FileWriter *writer, const char *path)
+{
+  snprintf(writer->path, sizeof(writer->path), "%s", path);
+
+  // Hidden temporary file next to the file, rename only works on the same
+  // file system
+  const char *base    = getBaseName(writer->path);
+  int         dir_len = (int) (base - writer->path);
+  int         len     = snprintf(writer->temp_path, sizeof(writer->temp_path), "%.*s.%s.XXXXXX",
+                                 dir_len, writer->path, base);
+
+  writer->in_place = true;
+  if (len > 0 && (size_t) len < sizeof(writer->temp_path))
+  {
+    writer->fd = mkstemp(writer->temp_path);
+    if (writer->fd != -1)
+    {
+      if (copyFileMode(writer->fd, path))
+      {
+        writer->in_place = false;
+        return true;
+      }
+      close(writer->fd);
+      unlink(writer->temp_path);
+    }
+  }
+
+  writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  return writer->fd != -1;
+}
+
+static bool writeAll(int fd, const char *data, size_t size)
+{
+  while (size)
+  {
+    ssize_t written = write(fd, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool writerWrite(FileWriter *writer, const Str *chunks, int count)
+{
+  struct iovec iov[WRITER_IOV_MAX];
+
+  while (count > 0)
+  {
+    int    batch = count < WRITER_IOV_MAX ? count : WRITER_IOV_MAX;
+    size_t total = 0;
+    for (int i = 0; i < batch; i++)
+    {
+      iov[i].iov_base = chunks[i].data;
+      iov[i].iov_len  = chunks[i].size;
+      total += chunks[i].size;
+    }
+
+    ssize_t written = writev(writer->fd, iov, batch);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    // Finish a short write chunk by chunk
+    if ((size_t) written < total)
+    {
+      for (int i = 0; i < batch; i++)
+      {
+        size_t size = chunks[i].size;
+        if ((size_t) written >= size)
+        {
+          written -= size;
+          continue;
+        }
+        if (!writeAll(writer->fd, chunks[i].data + written, size - written))
+          return false;
+        written = 0;
+      }
+    }
+
+    chunks += batch;
+    count -= batch;
+  }
+  return true;
+}
+
+bool writerCommit(FileWriter *writer)
+{
+  bool ok = fsync(writer->fd) == 0;
+  ok      = close(writer->fd) == 0 && ok;
+  if (writer->in_place)
+    return ok;
+
+  if (ok && rename(writer->temp_path, writer->path) == 0)
+  {
+    // Make the rename itself durable
+    char dir[EDITOR_PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", writer->path);
+    getDirName(dir);
+    int dir_fd = open(dir, O_RDONLY);
+    if (dir_fd != -1)
+    {
+      fsync(dir_fd);
+      close(dir_fd);
+    }
+    return true;
+  }
+
+  int error = errno;
+  unlink(writer->temp_path);
+  errno = error;
+  return false;
+}
+
+void writerAbort(FileWriter *writer)
+{
+  int error = errno;
+  close(writer->fd);
+  if (!writer->in_place)
+    unlink(writer->temp_path);
+  errno = error;
+}
+
 int64_t getTime(void)
 {
   struct timeval time_val;
@@ -278,6 +594,86 @@ int64_t getTime(void)
   return time_val.tv_sec * 1000000 + time_val.tv_usec;
 }
 
+static void *threadMain(void *arg)
+{
+  Thread *thread = arg;
+  thread->func(thread->arg);
+  return NULL;
+}
+
+bool threadStart(Thread *thread, void (*func)(void *arg), void *arg)
+{
+  thread->func = func;
+  thread->arg  = arg;
+  return pthread_create(&thread->handle, NULL, threadMain, thread) == 0;
+}
+
+void threadJoin(Thread *thread)
+{
+  pthread_join(thread->handle, NULL);
+}
+
+int cpuCount(void)
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int) count : 1;
+}
+
+void mutexInit(Mutex *mutex)
+{
+  pthread_mutex_init(&mutex->handle, NULL);
+}
+
+void mutexFree(Mutex *mutex)
+{
+  pthread_mutex_destroy(&mutex->handle);
+}
+
+void mutexLock(Mutex *mutex)
+{
+  pthread_mutex_lock(&mutex->handle);
+}
+
+void mutexUnlock(Mutex *mutex)
+{
+  pthread_mutex_unlock(&mutex->handle);
+}
+
+void condInit(Cond *cond)
+{
+  pthread_cond_init(&cond->handle, NULL);
+}
+
+void condFree(Cond *cond)
+{
+  pthread_cond_destroy(&cond->handle);
+}
+
+void condWait(Cond *cond, Mutex *mutex)
+{
+  pthread_cond_wait(&cond->handle, &mutex->handle);
+}
+
+void condSignal(Cond *cond)
+{
+  pthread_cond_signal(&cond->handle);
+}
+
+void condBroadcast(Cond *cond)
+{
+  pthread_cond_broadcast(&cond->handle);
+}
+
+int64_t atomicLoad(const int64_t *value)
+{
+  return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void atomicStore(int64_t *value, int64_t new_value)
+{
+  __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
 void argsInit(int *argc, char ***argv)
 {
   UNUSED(argc);
@@ -2,6 +2,7 @@
 #define OS_UNIX_H
 
 #include <dirent.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -33,4 +34,32 @@ struct DirIter
   bool error;
 };
 
+struct Thread
+{
+  pthread_t handle;
+  void (*func)(void *arg);
+  void *arg;
+};
+
+struct Mutex
+{
+  pthread_mutex_t handle;
+};
+
+struct Cond
+{
+  pthread_cond_t handle;
+};
+
+// Chunks handed to a single writev call
+#define WRITER_IOV_MAX 1024
+
+struct FileWriter
+{
+  int  fd;
+  bool in_place;
+  char path[EDITOR_PATH_MAX];
+  char temp_path[EDITOR_PATH_MAX];
+};
+
 #endif
@@ -23,9 +23,18 @@ void osInit(void);
 void enableRawMode(void);
 void disableRawMode(void);
 
-bool readConsole(uint32_t *unicode_out, int timeout_ms);
-int  writeConsole(const void *buf, size_t count);
-int  getWindowSize(int *rows, int *cols);
+bool   readConsole(uint32_t *unicode_out, int timeout_ms);
+bool   hasConsoleInput(void);
+size_t peekConsoleBytes(const char **data, int timeout_ms);
+size_t pollConsoleBytes(const char **data);  // Buffered and ready bytes, never waits
+void   consumeConsoleBytes(size_t count);
+int    writeConsole(const void *buf, size_t count);
+int    getWindowSize(int *rows, int *cols);
+
+// Wait until there is input without reading it, any thread can end the wait
+// early with wakeConsole()
+bool waitConsole(int timeout_ms);
+void wakeConsole(void);
 
 // File
 typedef struct FileInfo FileInfo;
@@ -48,12 +57,54 @@ void                   dirClose(DirIter *iter);
 const char            *dirGetName(const DirIter *iter);
 
 FILE *openFile(const char *path, const char *mode);
+bool  makeDir(const char *path);
+bool  removeFile(const char *path);
+bool  syncFile(FILE *fp);
+bool  truncateFile(FILE *fp);
 bool  changeDir(const char *path);
 char *getFullPath(const char *path);
 
+// Takes an exclusive lock on an open file without waiting, false if another
+// process holds it. The lock is held until the file is closed, or the
+// process exits.
+bool lockFile(FILE *fp);
+
+// Writes a file through a temporary file that replaces it on commit, so a
+// failed write leaves the old content intact. Files that can't be replaced
+// without losing their links or owner are written in place.
+typedef struct Str        Str;
+typedef struct FileWriter FileWriter;
+bool                      writerOpen(FileWriter *writer, const char *path);
+bool                      writerWrite(FileWriter *writer, const Str *chunks, int count);
+bool                      writerCommit(FileWriter *writer);
+void                      writerAbort(FileWriter *writer);
+
 // Time
 int64_t getTime(void);
 
+// Thread
+typedef struct Thread Thread;
+bool                  threadStart(Thread *thread, void (*func)(void *arg), void *arg);
+void                  threadJoin(Thread *thread);
+int                   cpuCount(void);
+
+// Lock and condition variable for state shared between threads
+typedef struct Mutex Mutex;
+typedef struct Cond  Cond;
+void                 mutexInit(Mutex *mutex);
+void                 mutexFree(Mutex *mutex);
+void                 mutexLock(Mutex *mutex);
+void                 mutexUnlock(Mutex *mutex);
+void                 condInit(Cond *cond);
+void                 condFree(Cond *cond);
+void                 condWait(Cond *cond, Mutex *mutex);
+void                 condSignal(Cond *cond);
+void                 condBroadcast(Cond *cond);
+
+// Atomic access to values shared between threads
+int64_t atomicLoad(const int64_t *value);
+void    atomicStore(int64_t *value, int64_t new_value);
+
 // Command line
 void argsInit(int *argc, char ***argv);
 void argsFree(int argc, char **argv);
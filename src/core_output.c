@@ -2,17 +2,22 @@
 
 #include "core_config.h"
 #include "core_editor.h"
+#include "core_file_io.h"
 #include "core_highlight.h"
 #include "core_os.h"
+#include "core_overlay.h"
+#include "core_screen.h"
 #include "core_select.h"
 #include "core_terminal.h"
 #include "core_unicode.h"
 
 #include <ctype.h>
 
+// Background spans of the row being drawn, reused between frames
+static EditorOverlay overlay;
+
 /**
  * editorDrawTopStatusBar - Draw the top status bar with file tabs
- * @ab: Append buffer to write to
  * 
  * Draws the top bar showing:
  * - Navigation arrows (< >) if there are more tabs
@@ -20,7 +25,7 @@
  * - Editor name and version on the right
  * - Loading message when in loading state
  */
-static void editorDrawTopStatusBar(abuf *ab)
+static void editorDrawTopStatusBar(void)
 {
   const char *right_buf      = "  " EDITOR_NAME " v" EDITOR_VERSION " ";
   bool        has_more_files = false;
@@ -28,16 +33,16 @@ static void editorDrawTopStatusBar(abuf *ab)
   int         len            = gEditor.explorer.width;
 
   // Move to the position after explorer panel
-  gotoXY(ab, 1, gEditor.explorer.width + 1);
+  editorScreenGoto(1, gEditor.explorer.width + 1);
 
   // Set colors for top status bar
-  setColor(ab, gEditor.color_cfg.top_status[0], 0);
-  setColor(ab, gEditor.color_cfg.top_status[1], 1);
+  editorScreenSetColor(COLOR_SLOT(top_status[0]), 0);
+  editorScreenSetColor(COLOR_SLOT(top_status[1]), 1);
 
   // Draw left arrow if there are tabs scrolled off-screen to the left
   if (gEditor.tab_offset != 0)
   {
-    abufAppendN(ab, "<", 1);
+    editorScreenPutN("<", 1);
     len++;
   }
 
@@ -48,7 +53,7 @@ static void editorDrawTopStatusBar(abuf *ab)
   {
     const char *loading_text     = "Loading...";
     int         loading_text_len = strlen(loading_text);
-    abufAppendN(ab, loading_text, loading_text_len);
+    editorScreenPutN(loading_text, loading_text_len);
     len = loading_text_len;
   }
   else
@@ -66,13 +71,13 @@ static void editorDrawTopStatusBar(abuf *ab)
       bool is_current = (file == gCurFile);
       if (is_current)
       {
-        setColor(ab, gEditor.color_cfg.top_status[4], 0);
-        setColor(ab, gEditor.color_cfg.top_status[5], 1);
+        editorScreenSetColor(COLOR_SLOT(top_status[4]), 0);
+        editorScreenSetColor(COLOR_SLOT(top_status[5]), 1);
       }
       else
       {
-        setColor(ab, gEditor.color_cfg.top_status[2], 0);
-        setColor(ab, gEditor.color_cfg.top_status[3], 1);
+        editorScreenSetColor(COLOR_SLOT(top_status[2]), 0);
+        editorScreenSetColor(COLOR_SLOT(top_status[3]), 1);
       }
 
       // Format tab text with filename and dirty indicator
@@ -114,20 +119,20 @@ static void editorDrawTopStatusBar(abuf *ab)
       if (tab_width < 0)
         break;
 
-      abufAppendN(ab, buf, buf_len);
+      editorScreenPutN(buf, buf_len);
       len += tab_width;
       gEditor.tab_displayed++;
     }
   }
 
   // Reset to default status bar colors
-  setColor(ab, gEditor.color_cfg.top_status[0], 0);
-  setColor(ab, gEditor.color_cfg.top_status[1], 1);
+  editorScreenSetColor(COLOR_SLOT(top_status[0]), 0);
+  editorScreenSetColor(COLOR_SLOT(top_status[1]), 1);
 
   // Draw right arrow if there are more tabs off-screen to the right
   if (has_more_files)
   {
-    abufAppendN(ab, ">", 1);
+    editorScreenPutN(">", 1);
     len++;
   }
 
@@ -136,12 +141,12 @@ static void editorDrawTopStatusBar(abuf *ab)
   {
     if (gEditor.screen_cols - len == rlen)
     {
-      abufAppendN(ab, right_buf, rlen);
+      editorScreenPutN(right_buf, rlen);
       break;
     }
     else
     {
-      abufAppendN(ab, " ", 1);
+      editorScreenPutN(" ", 1);
       len++;
     }
   }
@@ -149,13 +154,12 @@ static void editorDrawTopStatusBar(abuf *ab)
 
 /**
  * editorDrawConMsg - Draw console messages
- * @ab: Append buffer to write to
  * 
  * Draws console/status messages at the bottom of the screen,
  * just above the prompt line. Messages are displayed in a
  * circular buffer queue.
  */
-static void editorDrawConMsg(abuf *ab)
+static void editorDrawConMsg(void)
 {
   // Return early if no messages to display
   if (gEditor.con_size == 0)
@@ -164,8 +168,8 @@ static void editorDrawConMsg(abuf *ab)
   }
 
   // Set prompt colors for console messages
-  setColor(ab, gEditor.color_cfg.prompt[0], 0);
-  setColor(ab, gEditor.color_cfg.prompt[1], 1);
+  editorScreenSetColor(COLOR_SLOT(prompt[0]), 0);
+  editorScreenSetColor(COLOR_SLOT(prompt[1]), 1);
 
   // Calculate starting row for console messages
   bool should_draw_prompt = (gEditor.state != EDIT_MODE && gEditor.state != EXPLORER_MODE);
@@ -179,7 +183,7 @@ static void editorDrawConMsg(abuf *ab)
   int index = gEditor.con_front;
   for (int i = 0; i < gEditor.con_size; i++)
   {
-    gotoXY(ab, draw_x, 0);
+    editorScreenGoto(draw_x, 0);
     draw_x++;
 
     const char *buf = gEditor.con_msg[index];
@@ -192,12 +196,12 @@ static void editorDrawConMsg(abuf *ab)
       len = gEditor.screen_cols;
     }
 
-    abufAppendN(ab, buf, len);
+    editorScreenPutN(buf, len);
 
     // Fill rest of line with spaces
     while (len < gEditor.screen_cols)
     {
-      abufAppendN(ab, " ", 1);
+      editorScreenPutN(" ", 1);
       len++;
     }
   }
@@ -205,13 +209,12 @@ static void editorDrawConMsg(abuf *ab)
 
 /**
  * editorDrawPrompt - Draw the prompt line
- * @ab: Append buffer to write to
  * 
  * Draws the command prompt at the bottom of the screen when
  * not in edit or explorer mode. Shows prompt text on left
  * and additional info on right.
  */
-static void editorDrawPrompt(abuf *ab)
+static void editorDrawPrompt(void)
 {
   // Only draw prompt in non-edit modes
   bool should_draw_prompt = (gEditor.state != EDIT_MODE && gEditor.state != EXPLORER_MODE);
@@ -221,11 +224,11 @@ static void editorDrawPrompt(abuf *ab)
   }
 
   // Set prompt colors
-  setColor(ab, gEditor.color_cfg.prompt[0], 0);
-  setColor(ab, gEditor.color_cfg.prompt[1], 1);
+  editorScreenSetColor(COLOR_SLOT(prompt[0]), 0);
+  editorScreenSetColor(COLOR_SLOT(prompt[1]), 1);
 
   // Move to bottom line
-  gotoXY(ab, gEditor.screen_rows - 1, 0);
+  editorScreenGoto(gEditor.screen_rows - 1, 0);
 
   // Get left and right prompt text
   const char *left = gEditor.prompt;
@@ -246,19 +249,19 @@ static void editorDrawPrompt(abuf *ab)
     len = gEditor.screen_cols - rlen;
   }
 
-  abufAppendN(ab, left, len);
+  editorScreenPutN(left, len);
 
   // Fill middle with spaces and draw right text at end
   while (len < gEditor.screen_cols)
   {
     if (gEditor.screen_cols - len == rlen)
     {
-      abufAppendN(ab, right, rlen);
+      editorScreenPutN(right, rlen);
       break;
     }
     else
     {
-      abufAppendN(ab, " ", 1);
+      editorScreenPutN(" ", 1);
       len++;
     }
   }
@@ -266,21 +269,20 @@ static void editorDrawPrompt(abuf *ab)
 
 /**
  * editorDrawStatusBar - Draw the bottom status bar
- * @ab: Append buffer to write to
  * 
  * Draws the status bar at the very bottom showing:
  * - Help text with keyboard shortcuts (left)
  * - File type/language (middle-right)
  * - Cursor position and line info (right)
  */
-static void editorDrawStatusBar(abuf *ab)
+static void editorDrawStatusBar(void)
 {
   // Move to last row
-  gotoXY(ab, gEditor.screen_rows, 0);
+  editorScreenGoto(gEditor.screen_rows, 0);
 
   // Set status bar colors
-  setColor(ab, gEditor.color_cfg.status[0], 0);
-  setColor(ab, gEditor.color_cfg.status[1], 1);
+  editorScreenSetColor(COLOR_SLOT(status[0]), 0);
+  editorScreenSetColor(COLOR_SLOT(status[1]), 1);
 
   const char *help_str = "";
   
@@ -292,11 +294,14 @@ static void editorDrawStatusBar(abuf *ab)
       " ^X: Quit  ^S: Open  ^P: Prompt",
       // PROMPT mode (2)
       " ^X: Cancel  Up: Back  Down: Next",
-      // Other PROMPT modes (3-6)
+      // Other PROMPT modes (3-7)
+      " ^X: Cancel",
       " ^X: Cancel",
       " ^X: Cancel",
       " ^X: Cancel",
       " ^X: Cancel",
+      // CONFIRM mode (8)
+      " Y: Yes  N: No  ^X: Cancel",
   };
   // END MODIFICATION
   
@@ -304,6 +309,15 @@ static void editorDrawStatusBar(abuf *ab)
   if (CONVAR_GETINT(helpinfo))
     help_str = help_info[gEditor.state];
 
+  // A background save replaces the help text until it is done
+  char progress[32];
+  int  percent = gEditor.file_count ? editorSaveProgress(gCurFile) : -1;
+  if (percent >= 0)
+  {
+    snprintf(progress, sizeof(progress), " Saving... %d%%", percent);
+    help_str = progress;
+  }
+
   char lang[16];
   char pos[64];
   int  len = strlen(help_str);
@@ -347,7 +361,7 @@ static void editorDrawStatusBar(abuf *ab)
     len = gEditor.screen_cols - rlen;
 
   // Draw help text
-  abufAppendN(ab, help_str, len);
+  editorScreenPutN(help_str, len);
 
   // Fill middle and draw file info on right
   while (len < gEditor.screen_cols)
@@ -355,19 +369,19 @@ static void editorDrawStatusBar(abuf *ab)
     if (gEditor.screen_cols - len == rlen)
     {
       // Draw language/file type
-      setColor(ab, gEditor.color_cfg.status[2], 0);
-      setColor(ab, gEditor.color_cfg.status[3], 1);
-      abufAppendN(ab, lang, lang_len);
+      editorScreenSetColor(COLOR_SLOT(status[2]), 0);
+      editorScreenSetColor(COLOR_SLOT(status[3]), 1);
+      editorScreenPutN(lang, lang_len);
       
       // Draw position info
-      setColor(ab, gEditor.color_cfg.status[4], 0);
-      setColor(ab, gEditor.color_cfg.status[5], 1);
-      abufAppendN(ab, pos, pos_len);
+      editorScreenSetColor(COLOR_SLOT(status[4]), 0);
+      editorScreenSetColor(COLOR_SLOT(status[5]), 1);
+      editorScreenPutN(pos, pos_len);
       break;
     }
     else
     {
-      abufAppendN(ab, " ", 1);
+      editorScreenPutN(" ", 1);
       len++;
     }
   }
@@ -375,24 +389,23 @@ static void editorDrawStatusBar(abuf *ab)
 
 /**
  * editorDrawRows - Draw the text editor content area
- * @ab: Append buffer to write to
  * 
  * Draws all visible text rows with:
  * - Line numbers (if enabled)
  * - Syntax highlighting
- * - Selection highlighting
+ * - Selection, search match and trailing whitespace backgrounds (overlay)
  * - Special character visualization (tabs, spaces, control chars)
  * - Current line highlighting
  */
-static void editorDrawRows(abuf *ab)
+static void editorDrawRows(void)
 {
-  // Set background color
-  setColor(ab, gEditor.color_cfg.bg, 1);
+  // Palette slot of every background type
+  uint8_t bg_slot[HL_BG_COUNT];
+  for (int i = 0; i < HL_BG_COUNT; i++)
+    bg_slot[i] = COLOR_SLOT(highlightBg) + i;
 
-  // Get selection range if text is selected
-  EditorSelectRange range = {0};
-  if (gCurFile->cursor.is_selected)
-    getSelectStartEnd(&range);
+  // Set background color
+  editorScreenSetColor(COLOR_SLOT(bg), 1);
 
   // Draw each visible row
   for (int i = gCurFile->row_offset, s_row = 2; i < gCurFile->row_offset + gEditor.display_rows;
@@ -402,10 +415,10 @@ static void editorDrawRows(abuf *ab)
     bool is_row_full = false;
 
     // Move cursor to the beginning of the row
-    gotoXY(ab, s_row, 1 + gEditor.explorer.width);
+    editorScreenGoto(s_row, 1 + gEditor.explorer.width);
 
     // Set default background for normal text
-    gEditor.color_cfg.highlightBg[HL_BG_NORMAL] = gEditor.color_cfg.bg;
+    bg_slot[HL_BG_NORMAL] = COLOR_SLOT(bg);
     
     // Only draw if row exists in file
     if (i < gCurFile->num_rows)
@@ -421,27 +434,27 @@ static void editorDrawRows(abuf *ab)
           // Only highlight line if no selection active
           if (!gCurFile->cursor.is_selected)
           {
-            gEditor.color_cfg.highlightBg[HL_BG_NORMAL] = gEditor.color_cfg.cursor_line;
+            bg_slot[HL_BG_NORMAL] = COLOR_SLOT(cursor_line);
           }
-          setColor(ab, gEditor.color_cfg.line_number[1], 0);
-          setColor(ab, gEditor.color_cfg.line_number[0], 1);
+          editorScreenSetColor(COLOR_SLOT(line_number[1]), 0);
+          editorScreenSetColor(COLOR_SLOT(line_number[0]), 1);
         }
         else
         {
-          setColor(ab, gEditor.color_cfg.line_number[0], 0);
-          setColor(ab, gEditor.color_cfg.line_number[1], 1);
+          editorScreenSetColor(COLOR_SLOT(line_number[0]), 0);
+          editorScreenSetColor(COLOR_SLOT(line_number[1]), 1);
         }
 
         // Format and draw line number (1-indexed)
         len = snprintf(line_number, sizeof(line_number), " %*d ", gCurFile->licore_width - 2,
                        i + 1);
 
-        abufAppendN(ab, line_number, len);
+        editorScreenPutN(line_number, len);
       }
 
       // Clear to end of line and reset colors
-      abufAppendStr(ab, ANSI_CLEAR);
-      setColor(ab, gEditor.color_cfg.bg, 1);
+      editorScreenResetColor();
+      editorScreenSetColor(COLOR_SLOT(bg), 1);
 
       // Calculate visible columns and starting position
       int cols       = gEditor.screen_cols - gEditor.explorer.width - LICORE_WIDTH();
@@ -455,15 +468,23 @@ static void editorDrawRows(abuf *ab)
       rlen        = is_row_full ? cols : rlen;
       rlen += gCurFile->col_offset;
 
+      // Collect backgrounds of the visible part of the row
+      int col_end = editorRowRxToCx(&gCurFile->row[i], gCurFile->col_offset + cols);
+      if (col_end < gCurFile->row[i].size)
+        col_end = editorRowNextUTF8(&gCurFile->row[i], col_end);
+      editorOverlayBuildRow(&overlay, gCurFile, i, col_offset, col_end);
+      editorHighlightEnsureVisible(gCurFile, &gCurFile->row[i], col_offset, col_end);
+
       // Get pointers to character data and highlight info
-      char    *c       = &gCurFile->row[i].data[col_offset];
-      uint8_t *hl      = &(gCurFile->row[i].hl[col_offset]);
-      uint8_t  curr_fg = HL_BG_NORMAL;
-      uint8_t  curr_bg = HL_NORMAL;
+      char               *c       = &gCurFile->row[i].data[col_offset];
+      uint8_t             curr_fg = HL_NORMAL;
+      uint8_t             curr_bg = HL_BG_NORMAL;
+      EditorHighlightIter hl;
+      editorHighlightIterInit(&hl, &gCurFile->row[i]);
 
       // Set initial colors
-      setColor(ab, gEditor.color_cfg.highlightFg[curr_fg], 0);
-      setColor(ab, gEditor.color_cfg.highlightBg[curr_bg], 1);
+      editorScreenSetColor(COLOR_SLOT(highlightFg) + curr_fg, 0);
+      editorScreenSetColor(bg_slot[curr_bg], 1);
 
       // Draw each character in the row
       int j  = 0;
@@ -475,51 +496,39 @@ static void editorDrawRows(abuf *ab)
         {
           // Display as caret notation (e.g., ^A for Ctrl-A)
           char sym = (c[j] <= 26) ? '@' + c[j] : '?';
-          abufAppendStr(ab, ANSI_INVERT);
-          abufAppendN(ab, &sym, 1);
-          abufAppendStr(ab, ANSI_CLEAR);
-          setColor(ab, gEditor.color_cfg.highlightFg[curr_fg], 0);
-          setColor(ab, gEditor.color_cfg.highlightBg[curr_bg], 1);
+          editorScreenSetInvert(true);
+          editorScreenPutN(&sym, 1);
+          editorScreenResetColor();
+          editorScreenSetColor(COLOR_SLOT(highlightFg) + curr_fg, 0);
+          editorScreenSetColor(bg_slot[curr_bg], 1);
 
           rx++;
           j++;
         }
         else
         {
-          // Get syntax highlighting colors
-          uint8_t fg = hl[j] & HL_FG_MASK;
-          uint8_t bg = hl[j] >> HL_FG_BITS;
+          // Syntax color from the row, background from the overlay
+          uint8_t fg = editorHighlightIterAt(&hl, j + col_offset);
+          uint8_t bg = editorOverlayBgAt(&overlay, j + col_offset);
 
-          // Apply selection highlighting if character is selected
-          if (gCurFile->cursor.is_selected && isPosSelected(i, j + col_offset, range))
-          {
-            bg = HL_BG_SELECT;
-          }
-          
           // Highlight spaces/tabs if drawspace is enabled
           if (CONVAR_GETINT(drawspace) && (c[j] == ' ' || c[j] == '\t'))
           {
             fg = HL_SPACE;
           }
-          
-          // Don't show trailing whitespace highlight if disabled
-          if (bg == HL_BG_TRAILING && !CONVAR_GETINT(trailing))
-          {
-            bg = HL_BG_NORMAL;
-          }
 
           // Update foreground color if changed
           if (fg != curr_fg)
           {
             curr_fg = fg;
-            setColor(ab, gEditor.color_cfg.highlightFg[fg], 0);
+            editorScreenSetColor(COLOR_SLOT(highlightFg) + fg, 0);
           }
           
           // Update background color if changed
           if (bg != curr_bg)
           {
             curr_bg = bg;
-            setColor(ab, gEditor.color_cfg.highlightBg[bg], 1);
+            editorScreenSetColor(bg_slot[bg], 1);
           }
 
           // Handle tab characters
@@ -528,11 +537,11 @@ static void editorDrawRows(abuf *ab)
             // Show tab indicator if drawspace enabled
             if (CONVAR_GETINT(drawspace))
             {
-              abufAppendN(ab, "|", 1);
+              editorScreenPutN("|", 1);
             }
             else
             {
-              abufAppendN(ab, " ", 1);
+              editorScreenPutN(" ", 1);
             }
 
             rx++;
@@ -540,7 +549,7 @@ static void editorDrawRows(abuf *ab)
             // Fill to next tab stop
             while (rx % CONVAR_GETINT(tabsize) != 0 && rx < rlen)
             {
-              abufAppendN(ab, " ", 1);
+              editorScreenPutN(" ", 1);
               rx++;
             }
             j++;
@@ -551,15 +560,33 @@ static void editorDrawRows(abuf *ab)
             // Show dot if drawspace enabled
             if (CONVAR_GETINT(drawspace))
             {
-              abufAppendN(ab, ".", 1);
+              editorScreenPutN(".", 1);
             }
             else
             {
-              abufAppendN(ab, " ", 1);
+              editorScreenPutN(" ", 1);
             }
             rx++;
             j++;
           }
+          // Handle printable ASCII, emitted up to the next color change at once
+          else if (c[j] > ' ' && c[j] < 0x7f)
+          {
+            int span_end = editorHighlightIterEnd(&hl) - col_offset;
+            int bg_end   = editorOverlayNextBoundary(&overlay, j + col_offset) - col_offset;
+            if (bg_end < span_end)
+              span_end = bg_end;
+            if (span_end > j + (rlen - rx))
+              span_end = j + (rlen - rx);
+
+            int k = j + 1;
+            while (k < span_end && c[k] > ' ' && c[k] < 0x7f)
+              k++;
+
+            editorScreenPutN(&c[j], k - j);
+            rx += k - j;
+            j = k;
+          }
           // Handle regular UTF-8 characters
           else
           {
@@ -571,7 +598,7 @@ static void editorDrawRows(abuf *ab)
               rx += width;
               // Make sure double-width chars don't exceed screen
               if (rx <= rlen)
-                abufAppendN(ab, &c[j], byte_size);
+                editorScreenPutN(&c[j], byte_size);
             }
             j += byte_size;
           }
@@ -579,25 +606,24 @@ static void editorDrawRows(abuf *ab)
       }
 
       // Add newline character highlighting when line is selected
-      if (gCurFile->cursor.is_selected && range.end_y > i && i >= range.start_y &&
+      if (overlay.newline_bg != HL_BG_NORMAL &&
           gCurFile->row[i].rsize - gCurFile->col_offset < cols)
       {
-        setColor(ab, gEditor.color_cfg.highlightBg[HL_BG_SELECT], 1);
-        abufAppendN(ab, " ", 1);
+        editorScreenSetColor(bg_slot[overlay.newline_bg], 1);
+        editorScreenPutN(" ", 1);
       }
-      setColor(ab, gEditor.color_cfg.highlightBg[HL_BG_NORMAL], 1);
+      editorScreenSetColor(bg_slot[HL_BG_NORMAL], 1);
     }
     
     // Erase rest of line if row isn't full width
     if (!is_row_full)
-      abufAppendStr(ab, ANSI_ERASE_LINE);
-    setColor(ab, gEditor.color_cfg.bg, 1);
+      editorScreenEraseLine();
+    editorScreenSetColor(COLOR_SLOT(bg), 1);
   }
 }
 
 /**
  * editorDrawFileExplorer - Draw the file explorer sidebar
- * @ab: Append buffer to write to
  * 
  * Draws the file explorer panel showing:
  * - Explorer header
@@ -605,20 +631,20 @@ static void editorDrawRows(abuf *ab)
  * - Current selection highlight
  * - File/folder icons and colors
  */
-static void editorDrawFileExplorer(abuf *ab)
+static void editorDrawFileExplorer(void)
 {
   char *explorer_buf = malloc_s(gEditor.explorer.width + 1);
-  gotoXY(ab, 1, 1);
+  editorScreenGoto(1, 1);
 
   // Draw explorer header
-  setColor(ab, gEditor.color_cfg.explorer[3], 0);
+  editorScreenSetColor(COLOR_SLOT(explorer[3]), 0);
   if (gEditor.state == EXPLORER_MODE)
-    setColor(ab, gEditor.color_cfg.explorer[4], 1);  // Highlight if in explorer mode
+    editorScreenSetColor(COLOR_SLOT(explorer[4]), 1);  // Highlight if in explorer mode
   else
-    setColor(ab, gEditor.color_cfg.explorer[0], 1);
+    editorScreenSetColor(COLOR_SLOT(explorer[0]), 1);
 
   snprintf(explorer_buf, gEditor.explorer.width + 1, " EXPLORER%*s", gEditor.explorer.width, "");
-  abufAppendN(ab, explorer_buf, gEditor.explorer.width);
+  editorScreenPutN(explorer_buf, gEditor.explorer.width);
 
   // Calculate how many lines to display
   int lines = gEditor.explorer.flatten.size - gEditor.explorer.offset;
@@ -634,27 +660,27 @@ static void editorDrawFileExplorer(abuf *ab)
   // Draw each visible explorer entry
   for (int i = 0; i < lines; i++)
   {
-    gotoXY(ab, i + 2, 1);
+    editorScreenGoto(i + 2, 1);
 
     int                 index = gEditor.explorer.offset + i;
     EditorExplorerNode *node  = gEditor.explorer.flatten.data[index];
     
     // Highlight selected entry
     if (index == gEditor.explorer.selected_index)
-      setColor(ab, gEditor.color_cfg.explorer[1], 1);
+      editorScreenSetColor(COLOR_SLOT(explorer[1]), 1);
     else
-      setColor(ab, gEditor.color_cfg.explorer[0], 1);
+      editorScreenSetColor(COLOR_SLOT(explorer[0]), 1);
 
     // Set icon based on file type and state
     const char *icon = "";
     if (node->is_directory)
     {
-      setColor(ab, gEditor.color_cfg.explorer[2], 0);
+      editorScreenSetColor(COLOR_SLOT(explorer[2]), 0);
       icon = node->is_open ? "v " : "> ";  // Expanded vs collapsed
     }
     else
     {
-      setColor(ab, gEditor.color_cfg.explorer[3], 0);
+      editorScreenSetColor(COLOR_SLOT(explorer[3]), 0);
     }
     
     const char *filename = getBaseName(node->filename);
@@ -662,19 +688,19 @@ static void editorDrawFileExplorer(abuf *ab)
     // Format with indentation based on depth
     snprintf(explorer_buf, gEditor.explorer.width + 1, "%*s%s%s%*s", node->depth * 2, "", icon,
              filename, gEditor.explorer.width, "");
-    abufAppendN(ab, explorer_buf, gEditor.explorer.width);
+    editorScreenPutN(explorer_buf, gEditor.explorer.width);
   }
 
   // Draw blank lines to fill rest of explorer panel
-  setColor(ab, gEditor.color_cfg.explorer[0], 1);
-  setColor(ab, gEditor.color_cfg.explorer[3], 0);
+  editorScreenSetColor(COLOR_SLOT(explorer[0]), 1);
+  editorScreenSetColor(COLOR_SLOT(explorer[3]), 0);
 
   memset(explorer_buf, ' ', gEditor.explorer.width);
 
   for (int i = 0; i < gEditor.display_rows - lines; i++)
   {
-    gotoXY(ab, lines + i + 2, 1);
-    abufAppendN(ab, explorer_buf, gEditor.explorer.width);
+    editorScreenGoto(lines + i + 2, 1);
+    editorScreenPutN(explorer_buf, gEditor.explorer.width);
   }
 
   free(explorer_buf);
@@ -692,27 +718,26 @@ static void editorDrawFileExplorer(abuf *ab)
  * - Bottom status bar
  * - Cursor positioning
  * 
- * Called whenever the screen needs to be redrawn.
+ * Called whenever the screen needs to be redrawn. The frame is drawn into
+ * the screen buffer and only the cells that changed are written out.
  */
 void editorRefreshScreen(void)
 {
-  abuf ab = ABUF_INIT;
-
-  // Hide cursor and reset position during drawing
-  abufAppendStr(&ab, ANSI_CURSOR_HIDE ANSI_CURSOR_RESET_POS);
+  editorScreenBegin(gEditor.screen_rows, gEditor.screen_cols);
 
   // Draw all UI components
-  editorDrawTopStatusBar(&ab);
-  editorDrawRows(&ab);
-  editorDrawFileExplorer(&ab);
+  editorDrawTopStatusBar();
+  editorDrawRows();
+  editorDrawFileExplorer();
 
-  editorDrawConMsg(&ab);
-  editorDrawPrompt(&ab);
+  editorDrawConMsg();
+  editorDrawPrompt();
 
-  editorDrawStatusBar(&ab);
+  editorDrawStatusBar();
 
   // Calculate cursor position
   bool should_show_cursor = true;
+  int  cursor_row, cursor_col;
   if (gEditor.state == EDIT_MODE)
   {
     // Calculate screen row (offset from top, accounting for status bar)
@@ -730,15 +755,14 @@ void editorRefreshScreen(void)
     {
       should_show_cursor = false;
     }
-    else
-    {
-      gotoXY(&ab, row, col + gEditor.explorer.width);
-    }
+    cursor_row = row;
+    cursor_col = col + gEditor.explorer.width;
   }
   else
   {
     // In prompt mode, position cursor in prompt area
-    gotoXY(&ab, gEditor.screen_rows - 1, gEditor.px + 1);
+    cursor_row = gEditor.screen_rows - 1;
+    cursor_col = gEditor.px + 1;
   }
 
   // Hide cursor in explorer mode
@@ -747,20 +771,13 @@ void editorRefreshScreen(void)
     should_show_cursor = false;
   }
 
-  // Show or hide cursor based on calculated state
-  if (should_show_cursor)
-  {
-    abufAppendStr(&ab, ANSI_CURSOR_SHOW);
-  }
-  else
-  {
-    abufAppendStr(&ab, ANSI_CURSOR_HIDE);
-  }
+  editorScreenSetCursor(cursor_row, cursor_col, should_show_cursor);
 
-  // Clear any remaining formatting
-  abufAppendStr(&ab, ANSI_CLEAR);
+  // Write only what changed since the last frame
+  editorScreenFlush();
+}
 
-  // Write everything to console at once
-  writeConsoleAll(ab.buf, ab.len);
-  abufFree(&ab);
-}
\ No newline at end of file
+void editorFreeOutput(void)
+{
+  editorOverlayFree(&overlay);
+}
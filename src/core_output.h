@@ -49,4 +49,9 @@
  */
 void editorRefreshScreen(void);
 
+/**
+ * editorFreeOutput - Free the buffers kept between frames
+ */
+void editorFreeOutput(void);
+
 #endif
\ No newline at end of file
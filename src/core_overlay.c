@@ -0,0 +1,244 @@
+#include "core_overlay.h"
+
+#include "core_config.h"
+#include "core_editor.h"
+#include "core_select.h"
+
+// Higher priority wins when spans of different layers overlap
+static const uint8_t overlay_priority[HL_BG_COUNT] = {
+    [HL_BG_NORMAL]   = 0,
+    [HL_BG_TRAILING] = 1,
+    [HL_BG_MATCH]    = 2,
+    [HL_BG_SELECT]   = 3,
+};
+
+/**
+ * editorOverlayAdd - Add a span to a layer, clipped to the visible window
+ * @overlay: Overlay to add to
+ * @bg: Background type (layer)
+ * @start: First byte of the span
+ * @end: One past the last byte of the span
+ * @win_start: First visible byte
+ * @win_end: One past the last visible byte
+ *
+ * Spans of the same layer must be added in increasing order.
+ */
+static void editorOverlayAdd(EditorOverlay *overlay, uint8_t bg, int start, int end, int win_start,
+                             int win_end)
+{
+  if (start < win_start)
+    start = win_start;
+  if (end > win_end)
+    end = win_end;
+  if (start >= end)
+    return;
+
+  EditorOverlaySpan span = {.start = start, .end = end, .bg = bg};
+  vector_push(overlay->layers[bg], span);
+}
+
+/**
+ * editorOverlayAddSelection - Add the selected part of a row
+ * @overlay: Overlay to add to
+ * @file: File containing the row
+ * @row: Row index
+ * @start: First visible byte
+ * @end: One past the last visible byte
+ */
+static void editorOverlayAddSelection(EditorOverlay *overlay, const EditorFile *file, int row,
+                                      int start, int end)
+{
+  if (!file->cursor.is_selected)
+    return;
+
+  EditorSelectRange range;
+  getSelectStartEnd(&range);
+
+  if (row < range.start_y || row > range.end_y)
+    return;
+
+  int sel_start = (row == range.start_y) ? range.start_x : 0;
+  int sel_end   = (row == range.end_y) ? range.end_x : file->row[row].size;
+  editorOverlayAdd(overlay, HL_BG_SELECT, sel_start, sel_end, start, end);
+
+  // The line break is selected too
+  if (row < range.end_y)
+    overlay->newline_bg = HL_BG_SELECT;
+}
+
+/**
+ * editorOverlayAddMatches - Add the search matches visible in a row
+ * @overlay: Overlay to add to
+ * @file: File containing the row
+ * @row: Row index
+ * @start: First visible byte
+ * @end: One past the last visible byte
+ *
+ * Only the visible window (extended by the query length so that partially
+ * visible matches are found) is searched.
+ */
+static void editorOverlayAddMatches(EditorOverlay *overlay, const EditorFile *file, int row,
+                                    int start, int end)
+{
+  const char *query = gEditor.find_query;
+  if (!query || !query[0])
+    return;
+
+  const EditorRow *r   = &file->row[row];
+  size_t           len = strlen(query);
+
+  size_t col   = (start > (int) len - 1) ? (size_t) (start - (int) len + 1) : 0;
+  size_t limit = (size_t) end + len - 1;
+  if (limit > (size_t) r->size)
+    limit = (size_t) r->size;
+
+  while (col < limit)
+  {
+    int match_idx = findSubstring(r->data, limit, query, len, col, gEditor.find_ignore_case);
+    if (match_idx < 0)
+      break;
+
+    col = (size_t) match_idx;
+    editorOverlayAdd(overlay, HL_BG_MATCH, (int) col, (int) (col + len), start, end);
+    col += len;
+  }
+}
+
+/**
+ * editorOverlayAddTrailing - Add the trailing whitespace of a row
+ * @overlay: Overlay to add to
+ * @file: File containing the row
+ * @row: Row index
+ * @start: First visible byte
+ * @end: One past the last visible byte
+ */
+static void editorOverlayAddTrailing(EditorOverlay *overlay, const EditorFile *file, int row,
+                                     int start, int end)
+{
+  if (!CONVAR_GETINT(trailing))
+    return;
+
+  const EditorRow *r = &file->row[row];
+
+  int i = r->size;
+  while (i > 0 && (r->data[i - 1] == ' ' || r->data[i - 1] == '\t'))
+    i--;
+
+  editorOverlayAdd(overlay, HL_BG_TRAILING, i, r->size, start, end);
+}
+
+/**
+ * editorOverlayResolve - Merge all layers into disjoint spans
+ * @overlay: Overlay whose layers are filled
+ * @start: First visible byte
+ * @end: One past the last visible byte
+ *
+ * Sweeps the window from left to right. At every position the covering
+ * span with the highest priority wins, and the sweep jumps straight to
+ * the next span boundary of any layer. Adjacent results with the same
+ * background are coalesced.
+ */
+static void editorOverlayResolve(EditorOverlay *overlay, int start, int end)
+{
+  size_t idx[HL_BG_COUNT] = {0};
+  int    pos              = start;
+
+  while (pos < end)
+  {
+    uint8_t best = HL_BG_NORMAL;
+    int     next = end;
+
+    for (int bg = HL_BG_NORMAL + 1; bg < HL_BG_COUNT; bg++)
+    {
+      const EditorOverlaySpanList *layer = &overlay->layers[bg];
+
+      // Skip spans that are already behind us
+      while (idx[bg] < layer->size && layer->data[idx[bg]].end <= pos)
+        idx[bg]++;
+
+      if (idx[bg] == layer->size)
+        continue;
+
+      const EditorOverlaySpan *span = &layer->data[idx[bg]];
+      if (span->start <= pos)
+      {
+        if (overlay_priority[bg] > overlay_priority[best])
+          best = bg;
+        if (span->end < next)
+          next = span->end;
+      }
+      else if (span->start < next)
+      {
+        next = span->start;
+      }
+    }
+
+    if (best != HL_BG_NORMAL)
+    {
+      EditorOverlaySpan *last =
+          overlay->spans.size ? &overlay->spans.data[overlay->spans.size - 1] : NULL;
+      if (last && last->bg == best && last->end == pos)
+      {
+        last->end = next;
+      }
+      else
+      {
+        EditorOverlaySpan span = {.start = pos, .end = next, .bg = best};
+        vector_push(overlay->spans, span);
+      }
+    }
+
+    pos = next;
+  }
+}
+
+void editorOverlayBuildRow(EditorOverlay *overlay, const EditorFile *file, int row, int start,
+                           int end)
+{
+  for (int bg = 0; bg < HL_BG_COUNT; bg++)
+    overlay->layers[bg].size = 0;
+  overlay->spans.size = 0;
+  overlay->next       = 0;
+  overlay->newline_bg = HL_BG_NORMAL;
+
+  editorOverlayAddSelection(overlay, file, row, start, end);
+  editorOverlayAddMatches(overlay, file, row, start, end);
+  editorOverlayAddTrailing(overlay, file, row, start, end);
+
+  editorOverlayResolve(overlay, start, end);
+}
+
+uint8_t editorOverlayBgAt(EditorOverlay *overlay, int col)
+{
+  while (overlay->next < overlay->spans.size && overlay->spans.data[overlay->next].end <= col)
+    overlay->next++;
+
+  if (overlay->next < overlay->spans.size && overlay->spans.data[overlay->next].start <= col)
+    return overlay->spans.data[overlay->next].bg;
+
+  return HL_BG_NORMAL;
+}
+
+int editorOverlayNextBoundary(const EditorOverlay *overlay, int col)
+{
+  if (overlay->next == overlay->spans.size)
+    return INT_MAX;
+
+  const EditorOverlaySpan *span = &overlay->spans.data[overlay->next];
+  return (span->start <= col) ? span->end : span->start;
+}
+
+void editorOverlayFree(EditorOverlay *overlay)
+{
+  for (int bg = 0; bg < HL_BG_COUNT; bg++)
+  {
+    free(overlay->layers[bg].data);
+    overlay->layers[bg].data     = NULL;
+    overlay->layers[bg].size     = 0;
+    overlay->layers[bg].capacity = 0;
+  }
+  free(overlay->spans.data);
+  overlay->spans.data     = NULL;
+  overlay->spans.size     = 0;
+  overlay->spans.capacity = 0;
+}
@@ -0,0 +1,86 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include "core_highlight.h"
+#include "core_utils.h"
+
+/**
+ * struct EditorOverlaySpan - Background highlight over a byte range of a row
+ * @start: First byte covered by the span
+ * @end: One past the last byte covered by the span
+ * @bg: Background type (enum EditorHighlightBg)
+ */
+typedef struct EditorOverlaySpan
+{
+  int     start;
+  int     end;
+  uint8_t bg;
+} EditorOverlaySpan;
+
+typedef VECTOR(EditorOverlaySpan) EditorOverlaySpanList;
+
+/**
+ * struct EditorOverlay - Background decorations of a single visible row
+ * @layers: Raw spans per background type, each sorted and non-overlapping
+ * @spans: Resolved spans, sorted, disjoint, one background per byte
+ * @next: Index into @spans used by editorOverlayBgAt()
+ * @newline_bg: Background of the cell drawn after the last character
+ *
+ * Backgrounds are not stored in EditorRow::hl. Every frame the renderer
+ * collects the decorations of a row (selection, search matches, trailing
+ * whitespace) into @layers, resolves overlaps by priority into @spans and
+ * then reads them back while walking the row from left to right.
+ *
+ * The vectors are reused between rows, so a single overlay can be kept
+ * around for the whole lifetime of the editor.
+ */
+typedef struct EditorOverlay
+{
+  EditorOverlaySpanList layers[HL_BG_COUNT];
+  EditorOverlaySpanList spans;
+  size_t                next;
+  uint8_t               newline_bg;
+} EditorOverlay;
+
+/**
+ * editorOverlayBuildRow - Collect and resolve the backgrounds of a row
+ * @overlay: Overlay to fill (previous content is discarded)
+ * @file: File containing the row
+ * @row: Row index
+ * @start: First visible byte of the row
+ * @end: One past the last visible byte of the row
+ *
+ * Only the byte window [@start, @end) is decorated, so the cost depends
+ * on the width of the screen rather than on the length of the row.
+ * Overlapping spans are resolved as SELECT > MATCH > TRAILING.
+ */
+void editorOverlayBuildRow(EditorOverlay *overlay, const EditorFile *file, int row, int start,
+                           int end);
+
+/**
+ * editorOverlayBgAt - Get the background of a byte
+ * @overlay: Overlay built by editorOverlayBuildRow()
+ * @col: Byte index in the row
+ *
+ * Must be called with non-decreasing @col for the same row.
+ *
+ * Returns: Background type (enum EditorHighlightBg)
+ */
+uint8_t editorOverlayBgAt(EditorOverlay *overlay, int col);
+
+/**
+ * editorOverlayNextBoundary - Get where the background may change next
+ * @overlay: Overlay positioned by editorOverlayBgAt() at @col
+ * @col: Byte index in the row
+ *
+ * Returns: First byte after @col with a possibly different background
+ */
+int editorOverlayNextBoundary(const EditorOverlay *overlay, int col);
+
+/**
+ * editorOverlayFree - Free the memory used by an overlay
+ * @overlay: Overlay to free
+ */
+void editorOverlayFree(EditorOverlay *overlay);
+
+#endif
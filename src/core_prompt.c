@@ -4,6 +4,7 @@
 #include "core_input.h"
 #include "core_output.h"
 #include "core_prompt.h"
+#include "core_task.h"
 #include "core_terminal.h"
 #include "core_unicode.h"
 
@@ -329,6 +330,49 @@ char *editorPrompt(const char *prompt, int state, void (*callback)(char *, int))
 
 // ========== Goto Line Feature ==========
 
+/**
+ * editorConfirm - Ask a yes or no question
+ * @fmt: Format string of the question (printf-style)
+ * @...: Variable arguments for format string
+ *
+ * Waits for Y or N, Esc and Ctrl+X answer no.
+ *
+ * Returns: true if the answer is yes
+ */
+bool editorConfirm(const char *fmt, ...)
+{
+  int old_state = gEditor.state;
+  gEditor.state = CONFIRM_MODE;
+
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(gEditor.prompt, sizeof(gEditor.prompt), fmt, ap);
+  va_end(ap);
+  gEditor.px = strlen(gEditor.prompt);
+
+  bool answer = false;
+  while (true)
+  {
+    editorRefreshScreen();
+
+    EditorInput input = editorReadKey();
+    int key = input.type == CHAR_INPUT ? (int) input.data.unicode : input.type;
+    editorFreeInput(&input);
+
+    if (key == 'y' || key == 'Y')
+    {
+      answer = true;
+      break;
+    }
+    if (key == 'n' || key == 'N' || key == ESC || key == CTRL_KEY('x'))
+      break;
+  }
+
+  editorSetPrompt("");
+  gEditor.state = old_state;
+  return answer;
+}
+
 /**
  * editorGotoCallback - Callback for goto line prompt
  * @query: Current input string
@@ -394,38 +438,357 @@ void editorGotoLine(void)
 // ========== Find/Search Feature ==========
 
 /**
- * struct FindList - Linked list node for search results
- * @prev: Previous match in list
- * @next: Next match in list
+ * struct FindMatch - Position of a search match
  * @row: Row number of match
  * @col: Column number of match
- * 
- * Used to store all matches for the current search query,
- * allowing navigation between results.
  */
-typedef struct FindList
+typedef struct FindMatch
 {
-  struct FindList *prev;
-  struct FindList *next;
-  int              row;
-  int              col;
-} FindList;
+  int row;
+  int col;
+} FindMatch;
+
+typedef VECTOR(FindMatch) FindMatchList;
 
 /**
- * findListFree - Free a find list
- * @thisptr: Pointer to first node to free
- * 
- * Frees all nodes in the find list.
+ * struct FindResult - Matches of one query
+ * @query: The query
+ * @ignore_case: Whether the query ignored case
+ * @matches: The matches in the order of the rows and columns
+ *
+ * Matches are kept in one array, so moving to the n-th match is an index
+ * and all of them are freed at once.
+ */
+typedef struct FindResult
+{
+  char         *query;
+  bool          ignore_case;
+  FindMatchList matches;
+} FindResult;
+
+// Matches of the query in the prompt and of the shorter queries typed on
+// the way to it, shortest first, so backspace doesn't search again
+static VECTOR(FindResult) find_results;
+
+// Most matches kept for shorter queries, the shortest go first
+#define FIND_CACHE_MATCHES (1 << 24)
+
+// Files with more bytes are searched by the worker pool
+#define FIND_PARALLEL_BYTES (1 << 22)
+
+// Bytes of rows searched by one task
+#define FIND_CHUNK_BYTES (1 << 18)
+
+static void findResultsFree(size_t keep)
+{
+  while (find_results.size > keep)
+  {
+    FindResult *result = &find_results.data[--find_results.size];
+    free(result->query);
+    free(result->matches.data);
+  }
+  if (!keep)
+  {
+    free(find_results.data);
+    memset(&find_results, 0, sizeof(find_results));
+  }
+}
+
+// Drop the shortest queries while more than FIND_CACHE_MATCHES matches are
+// kept, but keep the last @keep queries
+static void findResultsTrim(size_t keep)
+{
+  size_t cached = 0;
+  for (size_t i = 0; i < find_results.size; i++)
+    cached += find_results.data[i].matches.size;
+
+  size_t drop = 0;
+  while (find_results.size - drop > keep && cached > FIND_CACHE_MATCHES)
+  {
+    cached -= find_results.data[drop].matches.size;
+    free(find_results.data[drop].query);
+    free(find_results.data[drop].matches.data);
+    drop++;
+  }
+
+  if (drop)
+  {
+    find_results.size -= drop;
+    memmove(&find_results.data[0], &find_results.data[drop],
+            find_results.size * sizeof(FindResult));
+  }
+}
+
+static void findMatchAppend(FindMatchList *matches, int row, int col)
+{
+  FindMatch match = {.row = row, .col = col};
+  vector_push(*matches, match);
+}
+
+// Append the matches in a row, left to right without overlapping
+static void findRowMatches(FindMatchList *matches, const StrSearch *search,
+                           const EditorRow *row, int row_idx)
+{
+  size_t col = 0;
+  int    match;
+  while ((match = strSearchNext(search, row->data, (size_t) row->size, col)) >= 0)
+  {
+    findMatchAppend(matches, row_idx, match);
+    col = (size_t) match + search->len;
+  }
+}
+
+/**
+ * findQueryOverlaps - Check whether two matches of a query can overlap
+ * @query: The query
+ * @len: Length of @query
+ * @ignore_case: Whether case is ignored
+ *
+ * True if a proper prefix of @query is also a suffix of it, like "aba".
+ * Matches are found left to right without overlapping, so a match of
+ * such a query can hide one that a longer query would find.
+ *
+ * Returns: true if matches can overlap
+ */
+static bool findQueryOverlaps(const char *query, size_t len, bool ignore_case)
+{
+  for (size_t k = 1; k < len; k++)
+  {
+    const char *suffix = query + len - k;
+    size_t      i      = 0;
+    while (i < k && (ignore_case ? tolower((unsigned char) query[i]) ==
+                                       tolower((unsigned char) suffix[i])
+                                 : query[i] == suffix[i]))
+    {
+      i++;
+    }
+    if (i == k)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * struct FindChunk - Rows searched by one task
+ * @task: The task
+ * @search: The query
+ * @rows: Rows of the file
+ * @start: First row searched
+ * @end: Row after the last one searched
+ * @stop: Set once the search is canceled, shared by all chunks
+ * @matches: Matches found in the rows
+ */
+typedef struct FindChunk
+{
+  EditorTask       task;
+  const StrSearch *search;
+  const EditorRow *rows;
+  int              start;
+  int              end;
+  int64_t         *stop;
+  FindMatchList    matches;
+} FindChunk;
+
+static void findChunkRun(void *arg)
+{
+  FindChunk *chunk = arg;
+  for (int i = chunk->start; i < chunk->end; i++)
+  {
+    if (atomicLoad(chunk->stop))
+      return;
+    findRowMatches(&chunk->matches, chunk->search, &chunk->rows[i], i);
+  }
+}
+
+/**
+ * findScanParallel - Find the matches in all rows on the worker pool
+ * @result: Gets the matches
+ * @search: The query
+ *
+ * The rows are cut in chunks of about FIND_CHUNK_BYTES, each searched by a
+ * task. Waiting for the chunks in order runs the ones no worker took yet on
+ * this thread, then the matches of each chunk are appended in order. The
+ * rows can't change meanwhile, the prompt waits for the search.
+ *
+ * Returns: false if canceled
+ */
+static bool findScanParallel(FindResult *result, const StrSearch *search)
+{
+  VECTOR(FindChunk) chunks = {0};
+  int64_t stop             = 0;
+
+  int    start = 0;
+  size_t bytes = 0;
+  for (int i = 0; i < gCurFile->num_rows; i++)
+  {
+    bytes += (size_t) gCurFile->row[i].size + 1;
+    if (bytes < FIND_CHUNK_BYTES && i + 1 < gCurFile->num_rows)
+      continue;
+
+    FindChunk chunk = {
+        .search = search,
+        .rows   = gCurFile->row,
+        .start  = start,
+        .end    = i + 1,
+        .stop   = &stop,
+    };
+    vector_push(chunks, chunk);
+    start = i + 1;
+    bytes = 0;
+  }
+
+  // Start the tasks once the chunks don't move any more
+  for (size_t i = 0; i < chunks.size; i++)
+  {
+    chunks.data[i].task.run = findChunkRun;
+    chunks.data[i].task.arg = &chunks.data[i];
+    editorStartTask(&chunks.data[i].task);
+  }
+
+  bool   canceled = false;
+  size_t total    = 0;
+  for (size_t i = 0; i < chunks.size; i++)
+  {
+    if (!canceled && editorCheckCancel())
+    {
+      canceled = true;
+      atomicStore(&stop, 1);
+    }
+    editorWaitTask(&chunks.data[i].task);
+    total += chunks.data[i].matches.size;
+  }
+
+  if (!canceled && total)
+  {
+    result->matches.data     = malloc_s(total * sizeof(FindMatch));
+    result->matches.capacity = total;
+    for (size_t i = 0; i < chunks.size; i++)
+    {
+      const FindMatchList *matches = &chunks.data[i].matches;
+      memcpy(&result->matches.data[result->matches.size], matches->data,
+             matches->size * sizeof(FindMatch));
+      result->matches.size += matches->size;
+    }
+  }
+
+  for (size_t i = 0; i < chunks.size; i++)
+    free(chunks.data[i].matches.data);
+  free(chunks.data);
+  return !canceled;
+}
+
+// Find the matches in all rows, false if canceled
+static bool findScan(FindResult *result, const StrSearch *search)
+{
+  // With one core the chunks only add copying
+  if (gCurFile->bytes > FIND_PARALLEL_BYTES && cpuCount() > 1)
+    return findScanParallel(result, search);
+
+  for (int i = 0; i < gCurFile->num_rows; i++)
+  {
+    if (editorCheckCancel())
+      return false;
+    findRowMatches(&result->matches, search, &gCurFile->row[i], i);
+  }
+  return true;
+}
+
+// Keep the matches of a shorter query that the longer query matches at the
+// same place, false if canceled
+static bool findRefine(FindResult *result, const FindResult *from, const StrSearch *search)
+{
+  int    end_row = -1;
+  size_t end_col = 0;
+
+  for (size_t i = 0; i < from->matches.size; i++)
+  {
+    const FindMatch *m = &from->matches.data[i];
+
+    if (editorCheckCancel())
+      return false;
+
+    const EditorRow *row = &gCurFile->row[m->row];
+    size_t           end = (size_t) m->col + search->len;
+    if (end > (size_t) row->size)
+      continue;
+
+    // Skip a match overlapping the one kept before, as a scan would
+    if (m->row == end_row && (size_t) m->col < end_col)
+      continue;
+
+    if (strSearchNext(search, row->data, end, (size_t) m->col) != m->col)
+      continue;
+
+    findMatchAppend(&result->matches, m->row, m->col);
+    end_row = m->row;
+    end_col = end;
+  }
+  return true;
+}
+
+/**
+ * findGetResult - Get the matches of a query
+ * @query: The query
+ * @len: Length of @query
+ * @ignore_case: Whether to ignore case
+ *
+ * Results of queries that aren't a prefix of @query are dropped. A query
+ * still cached is returned as is. A query that grew from the last cached
+ * one only checks the matches of that one, every match of the longer query
+ * being among them. Otherwise all rows are searched.
+ *
+ * Returns: The result, owned by find_results, NULL if canceled
  */
-static void findListFree(FindList *thisptr)
+static FindResult *findGetResult(const char *query, size_t len, bool ignore_case)
 {
-  FindList *temp;
-  while (thisptr)
+  FindResult *from = NULL;
+  while (find_results.size)
+  {
+    from            = &find_results.data[find_results.size - 1];
+    size_t from_len = strlen(from->query);
+    if (from_len <= len && strncmp(from->query, query, from_len) == 0 &&
+        (from_len < len || from->ignore_case == ignore_case))
+      break;
+    findResultsFree(find_results.size - 1);
+    from = NULL;
+  }
+
+  if (from && strcmp(from->query, query) == 0)
+    return from;
+
+  StrSearch search;
+  strSearchInit(&search, query, len, ignore_case);
+
+  FindResult result = {.ignore_case = ignore_case};
+  result.query      = malloc_s(len + 1);
+  memcpy(result.query, query, len + 1);
+
+  // A case sensitive query can't refine one ignoring case
+  bool refine = from && (from->ignore_case || !ignore_case) &&
+                !findQueryOverlaps(from->query, strlen(from->query), from->ignore_case);
+
+  // Free what won't be kept before taking more memory
+  findResultsTrim(refine ? 1 : 0);
+  bool done = refine ? findRefine(&result, &find_results.data[find_results.size - 1], &search)
+                     : findScan(&result, &search);
+
+  if (!done)
   {
-    temp    = thisptr;
-    thisptr = thisptr->next;
-    free(temp);
+    free(result.query);
+    free(result.matches.data);
+    return NULL;
   }
+
+  // Give back the room left by growing, the result may stay cached
+  if (result.matches.size && result.matches.size < result.matches.capacity)
+  {
+    vector_shrink(result.matches);
+    result.matches.capacity = result.matches.size;
+  }
+
+  vector_push(find_results, result);
+  findResultsTrim(1);
+  return &find_results.data[find_results.size - 1];
 }
 
 /**
@@ -436,7 +799,7 @@ static void findListFree(FindList *thisptr)
  * Handles incremental search with the following features:
  * - Real-time search as you type
  * - Navigate results with Up/Down arrows
- * - Highlight current match
+ * - Highlight all visible matches (through gEditor.find_query)
  * - Show match count (e.g., "3 of 10")
  * - Case-sensitive or case-insensitive search (configurable)
  * - Smart case: case-insensitive if query is all lowercase
@@ -444,46 +807,20 @@ static void findListFree(FindList *thisptr)
 static void editorFindCallback(char *query, int key)
 {
   // Static variables maintain state between callback invocations
-  static char     *prev_query = NULL;  // Previous query to detect changes
-  static FindList  head       = {.prev = NULL, .next = NULL};  // List head
-  static FindList *match_node = NULL;  // Current match
-
-  // Saved highlight state for restoring after search
-  static uint8_t *saved_hl_pos = NULL;
-  static uint8_t *saved_hl     = NULL;
-  static size_t   saved_hl_len = 0;
-
-  static int total   = 0;  // Total matches found
-  static int current = 0;  // Current match index (1-based)
-
-  // Restore previous highlight before applying new one
-  if (saved_hl && saved_hl_pos)
-  {
-    memcpy(saved_hl_pos, saved_hl, saved_hl_len);
-    free(saved_hl);
-    saved_hl     = NULL;
-    saved_hl_pos = NULL;
-    saved_hl_len = 0;
-  }
+  static FindResult *result  = NULL;  // Matches of the current query
+  static size_t      current = 0;     // Index of the current match
 
   // Quit find mode
   // MODIFICATION: Changed cancel shortcut from Ctrl+Q to Ctrl+X
   if (key == ESC || key == CTRL_KEY('x') || key == '\r' || key == MOUSE_PRESSED)
   {
     // END MODIFICATION
+    // Stop highlighting matches
+    gEditor.find_query = NULL;
+
     // Clean up all allocated resources
-    if (prev_query)
-    {
-      free(prev_query);
-      prev_query = NULL;
-    }
-    if (saved_hl)
-    {
-      free(saved_hl);
-      saved_hl = NULL;
-    }
-    findListFree(head.next);
-    head.next = NULL;
+    findResultsFree(0);
+    result = NULL;
     editorSetRightPrompt("");
     return;
   }
@@ -491,30 +828,16 @@ static void editorFindCallback(char *query, int key)
   size_t len = strlen(query);
   if (len == 0)
   {
+    gEditor.find_query = NULL;
     editorSetRightPrompt("");
     return;
   }
 
-  FindList *tail_node = NULL;
-  
-  // Recompute search results if query changed
-  if (!head.next || !prev_query || strcmp(prev_query, query) != 0)
+  // Look the matches up again if the query changed
+  if (!gEditor.find_query || !result || strcmp(result->query, query) != 0)
   {
-    // Recompute find list
-
-    total   = 0;
-    current = 0;
-
-    match_node = NULL;
-    if (prev_query)
-      free(prev_query);
-    findListFree(head.next);
-    head.next = NULL;
-
-    // Save new query
-    prev_query = malloc_s(len + 1);
-    memcpy(prev_query, query, len + 1);
-    prev_query[len] = '\0';
+    current            = 0;
+    gEditor.find_query = NULL;
 
     // Determine case sensitivity mode
     int  ignorecase_mode = CONVAR_GETINT(ignorecase);
@@ -538,112 +861,56 @@ static void editorFindCallback(char *query, int key)
       }
       ignore_case = !has_upper;
     }
+    gEditor.find_ignore_case = ignore_case;
 
-    // Search through all rows
-    FindList *cur = &head;
-    for (int i = 0; i < gCurFile->num_rows; i++)
+    // Stop a search that takes too long, the next key starts over
+    result = findGetResult(query, len, ignore_case);
+    if (!result)
     {
-      size_t col     = 0;
-      size_t row_len = (size_t) gCurFile->row[i].size;
-
-      // Find all matches in current row
-      while (col < row_len)
-      {
-        int match_idx = findSubstring(gCurFile->row[i].data, row_len, query, len, col, ignore_case);
-        if (match_idx < 0)
-          break;
-
-        col = (size_t) match_idx;
-
-        // Add match to list
-        FindList *node = malloc_s(sizeof(FindList));
-        node->prev     = cur;
-        node->next     = NULL;
-        node->row      = i;
-        node->col      = (int) col;
-        cur->next      = node;
-        cur            = cur->next;
-        tail_node      = cur;
-
-        total++;
-        
-        // Find first match after cursor position
-        if (!match_node)
-        {
-          current++;
-          if (((i == gCurFile->cursor.y && col >= (size_t) gCurFile->cursor.x) ||
-               i > gCurFile->cursor.y))
-          {
-            match_node = cur;
-          }
-        }
-        col += len;
-      }
+      editorSetRightPrompt("  Search canceled");
+      return;
     }
 
     // No matches found
-    if (!head.next)
+    if (!result->matches.size)
     {
       editorSetRightPrompt("  No results");
       return;
     }
 
-    // If no match after cursor, wrap to first match
-    if (!match_node)
-      match_node = head.next;
-
-    // Make list circular (don't go back to dummy head)
-    head.next->prev = tail_node;
-  }
-
-  // Navigate between matches
-  if (key == ARROW_DOWN)
-  {
-    // Next match
-    if (match_node->next)
+    // Binary search the first match at or after the cursor, wrap to the
+    // first match if there is none
+    size_t lo = 0, hi = result->matches.size;
+    while (lo < hi)
     {
-      match_node = match_node->next;
-      current++;
-    }
-    else
-    {
-      // Wrap to first match
-      match_node = head.next;
-      current    = 1;
+      size_t           mid = lo + (hi - lo) / 2;
+      const FindMatch *m   = &result->matches.data[mid];
+      if (m->row < gCurFile->cursor.y ||
+          (m->row == gCurFile->cursor.y && m->col < gCurFile->cursor.x))
+        lo = mid + 1;
+      else
+        hi = mid;
     }
+    current = lo < result->matches.size ? lo : 0;
   }
+
+  // Let the renderer highlight every visible match
+  gEditor.find_query = result->query;
+
+  // Navigate between matches, wrapping around at both ends
+  if (key == ARROW_DOWN)
+    current = current + 1 < result->matches.size ? current + 1 : 0;
   else if (key == ARROW_UP)
-  {
-    // Previous match
-    match_node = match_node->prev;
-    if (current == 1)
-      current = total;
-    else
-      current--;
-  }
+    current = current ? current - 1 : result->matches.size - 1;
   
   // Show match count
-  editorSetRightPrompt("  %d of %d", current, total);
+  editorSetRightPrompt("  %zu of %zu", current + 1, result->matches.size);
 
   // Move cursor to current match
-  gCurFile->cursor.x = match_node->col;
-  gCurFile->cursor.y = match_node->row;
+  gCurFile->cursor.x = result->matches.data[current].col;
+  gCurFile->cursor.y = result->matches.data[current].row;
 
   editorScrollToCursorCenter();
-
-  // Highlight current match
-  uint8_t *match_pos = &gCurFile->row[match_node->row].hl[match_node->col];
-  saved_hl_len       = len;
-  saved_hl_pos       = match_pos;
-  saved_hl           = malloc_s(len + 1);
-  memcpy(saved_hl, match_pos, len);
-  
-  // Apply match highlight to all characters in match
-  for (size_t i = 0; i < len; i++)
-  {
-    match_pos[i] &= ~HL_BG_MASK;
-    match_pos[i] |= HL_BG_MATCH << HL_FG_BITS;
-  }
 }
 
 /**
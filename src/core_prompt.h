@@ -5,6 +5,7 @@ void editorMsg(const char *fmt, ...);
 void editorMsgClear(void);
 
 char *editorPrompt(const char *prompt, int state, void (*callback)(char *, int));
+bool  editorConfirm(const char *fmt, ...);
 void  editorGotoLine(void);
 void  editorFind(void);
 
@@ -25,6 +25,272 @@ static inline bool ensureCapacity(size_t capacity, size_t size, size_t *new_capa
   return true;
 }
 
+static void chunkRelease(EditorRowChunk *chunk)
+{
+  if (--chunk->refs == 0)
+    free(chunk);
+}
+
+void editorReleaseRowIndex(EditorRowIndex *index)
+{
+  if (!index || --index->refs > 0)
+    return;
+
+  for (int i = 0; i < index->num_chunks; i++)
+    chunkRelease(index->chunks[i]);
+  free(index->chunks);
+  free(index->starts);
+  free(index);
+}
+
+static void indexReserve(EditorRowIndex *index, int count)
+{
+  size_t new_capacity;
+  if (!ensureCapacity(index->capacity, count, &new_capacity))
+    return;
+
+  index->chunks   = realloc_s(index->chunks, sizeof(EditorRowChunk *) * new_capacity);
+  index->starts   = realloc_s(index->starts, sizeof(int) * new_capacity);
+  index->capacity = new_capacity;
+}
+
+// The index of the file, copied first if a snapshot holds it
+static EditorRowIndex *indexUnique(EditorFile *file)
+{
+  EditorRowIndex *index = file->index;
+  if (index && index->refs == 1)
+    return index;
+
+  EditorRowIndex *copy = malloc_s(sizeof(EditorRowIndex));
+  memset(copy, 0, sizeof(EditorRowIndex));
+  copy->refs = 1;
+
+  if (index && index->num_chunks)
+  {
+    indexReserve(copy, index->num_chunks);
+    memcpy(copy->chunks, index->chunks, sizeof(EditorRowChunk *) * index->num_chunks);
+    memcpy(copy->starts, index->starts, sizeof(int) * index->num_chunks);
+    copy->num_chunks = index->num_chunks;
+    for (int i = 0; i < copy->num_chunks; i++)
+      copy->chunks[i]->refs++;
+  }
+  if (index)
+    index->refs--;
+
+  file->index = copy;
+  return copy;
+}
+
+// Chunk @n of an index the file owns, copied first if a snapshot holds it
+static EditorRowChunk *chunkUnique(EditorRowIndex *index, int n)
+{
+  EditorRowChunk *chunk = index->chunks[n];
+  if (chunk->refs == 1)
+    return chunk;
+
+  EditorRowChunk *copy = malloc_s(sizeof(EditorRowChunk));
+  copy->refs           = 1;
+  copy->count          = chunk->count;
+  memcpy(copy->rows, chunk->rows, sizeof(Str) * chunk->count);
+  chunk->refs--;
+  index->chunks[n] = copy;
+  return copy;
+}
+
+// Chunk holding row @at, the end of the rows belongs to the last chunk
+static int indexFind(const EditorRowIndex *index, int at)
+{
+  int lo = 0;
+  int hi = index->num_chunks - 1;
+  while (lo < hi)
+  {
+    int mid = (lo + hi + 1) / 2;
+    if (index->starts[mid] <= at)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return lo;
+}
+
+// Count the first rows of the chunks again from chunk @n on
+static void indexUpdateStarts(EditorRowIndex *index, int n)
+{
+  if (index->num_chunks)
+    index->starts[0] = 0;
+  for (int i = n > 1 ? n : 1; i < index->num_chunks; i++)
+    index->starts[i] = index->starts[i - 1] + index->chunks[i - 1]->count;
+}
+
+static void indexSet(EditorFile *file, int at, const EditorRow *row)
+{
+  EditorRowIndex *index = indexUnique(file);
+  int             n     = indexFind(index, at);
+  EditorRowChunk *chunk = chunkUnique(index, n);
+  chunk->rows[at - index->starts[n]] = (Str) {row->data, row->size};
+}
+
+// Rows [at, at + count) were inserted into the row array
+static void indexInsert(EditorFile *file, int at, int count)
+{
+  EditorRowIndex  *index = indexUnique(file);
+  const EditorRow *rows  = &file->row[at];
+
+  if (!index->num_chunks)
+  {
+    EditorRowChunk *chunk = malloc_s(sizeof(EditorRowChunk));
+    chunk->refs           = 1;
+    chunk->count          = 0;
+    indexReserve(index, 1);
+    index->chunks[0]  = chunk;
+    index->starts[0]  = 0;
+    index->num_chunks = 1;
+  }
+
+  int             n      = indexFind(index, at);
+  int             offset = at - index->starts[n];
+  EditorRowChunk *chunk  = chunkUnique(index, n);
+
+  if (chunk->count + count <= ROW_CHUNK_SIZE)
+  {
+    memmove(&chunk->rows[offset + count], &chunk->rows[offset],
+            sizeof(Str) * (chunk->count - offset));
+    for (int i = 0; i < count; i++)
+      chunk->rows[offset + i] = (Str) {rows[i].data, rows[i].size};
+    chunk->count += count;
+    indexUpdateStarts(index, n + 1);
+    return;
+  }
+
+  int  total = chunk->count + count;
+  Str *all   = malloc_s(sizeof(Str) * total);
+  memcpy(all, chunk->rows, sizeof(Str) * offset);
+  for (int i = 0; i < count; i++)
+    all[offset + i] = (Str) {rows[i].data, rows[i].size};
+  memcpy(&all[offset + count], &chunk->rows[offset], sizeof(Str) * (chunk->count - offset));
+
+  int parts = (total + ROW_CHUNK_SIZE - 1) / ROW_CHUNK_SIZE;
+  indexReserve(index, index->num_chunks + parts - 1);
+  memmove(&index->chunks[n + parts], &index->chunks[n + 1],
+          sizeof(EditorRowChunk *) * (index->num_chunks - n - 1));
+  index->num_chunks += parts - 1;
+
+  // Rows appended at the end fill whole chunks, rows inserted in between
+  // are spread evenly so the next insert has room
+  bool appended = offset == chunk->count;
+  int  done     = 0;
+  for (int i = 0; i < parts; i++)
+  {
+    EditorRowChunk *part = i ? malloc_s(sizeof(EditorRowChunk)) : chunk;
+    int             size = appended ? ROW_CHUNK_SIZE : (total - done) / (parts - i);
+    part->refs           = 1;
+    part->count          = size < total - done ? size : total - done;
+    memcpy(part->rows, &all[done], sizeof(Str) * part->count);
+    done += part->count;
+    index->chunks[n + i] = part;
+  }
+  free(all);
+  indexUpdateStarts(index, n + 1);
+}
+
+// Join chunk @n with the next one if they fit into one
+static void indexMerge(EditorRowIndex *index, int n)
+{
+  if (n < 0 || n + 1 >= index->num_chunks ||
+      index->chunks[n]->count + index->chunks[n + 1]->count > ROW_CHUNK_SIZE)
+    return;
+
+  EditorRowChunk *chunk = chunkUnique(index, n);
+  EditorRowChunk *next  = index->chunks[n + 1];
+  memcpy(&chunk->rows[chunk->count], next->rows, sizeof(Str) * next->count);
+  chunk->count += next->count;
+  chunkRelease(next);
+
+  memmove(&index->chunks[n + 1], &index->chunks[n + 2],
+          sizeof(EditorRowChunk *) * (index->num_chunks - n - 2));
+  index->num_chunks--;
+}
+
+// Rows [at, at + count) were removed from the row array
+static void indexDelete(EditorFile *file, int at, int count)
+{
+  EditorRowIndex *index  = indexUnique(file);
+  int             first  = indexFind(index, at);
+  int             offset = at - index->starts[first];
+  int             kept   = first;
+  int             n      = first;
+
+  for (; count > 0 && n < index->num_chunks; n++)
+  {
+    int len = index->chunks[n]->count - offset;
+    if (len > count)
+      len = count;
+    count -= len;
+
+    if (len == index->chunks[n]->count)
+    {
+      chunkRelease(index->chunks[n]);
+    }
+    else
+    {
+      EditorRowChunk *chunk = chunkUnique(index, n);
+      memmove(&chunk->rows[offset], &chunk->rows[offset + len],
+              sizeof(Str) * (chunk->count - offset - len));
+      chunk->count -= len;
+      index->chunks[kept++] = chunk;
+    }
+    offset = 0;
+  }
+
+  // Close the gap of the chunks that were removed entirely
+  memmove(&index->chunks[kept], &index->chunks[n],
+          sizeof(EditorRowChunk *) * (index->num_chunks - n));
+  index->num_chunks -= n - kept;
+
+  indexMerge(index, first);
+  indexMerge(index, first - 1);
+  indexUpdateStarts(index, first);
+}
+
+// Newest generation a snapshot reads, row buffers older than it are shared
+static uint32_t sharedGen(const EditorFile *file)
+{
+  return file->snapshots.size ? file->snapshots.data[file->snapshots.size - 1]->gen : 0;
+}
+
+// Free a row buffer, or keep it while a snapshot can still read it
+static void editorRetireRow(EditorFile *file, EditorRow *row)
+{
+  if (row->data && row->gen < sharedGen(file))
+  {
+    EditorRetiredRow retired = {row->data, row->gen, file->gen};
+    vector_push(file->retired, retired);
+  }
+  else
+  {
+    free(row->data);
+  }
+}
+
+// Give a shared row its own buffer before it is modified
+static void editorRowDetach(EditorFile *file, EditorRow *row)
+{
+  if (!row->data)
+  {
+    // The buffer about to be allocated is not shared
+    row->gen = file->gen;
+    return;
+  }
+  if (row->gen >= sharedGen(file))
+    return;
+
+  char *data = malloc_s(row->capacity);
+  memcpy(data, row->data, row->size);
+  editorRetireRow(file, row);
+  row->data = data;
+  row->gen  = file->gen;
+}
+
 static void editorRowEnsureCapacity(EditorRow *row, size_t size)
 {
   size_t new_capacity;
@@ -32,10 +298,43 @@ static void editorRowEnsureCapacity(EditorRow *row, size_t size)
     return;
 
   row->data     = realloc_s(row->data, new_capacity);
-  row->hl       = realloc_s(row->hl, new_capacity);
   row->capacity = new_capacity;
 }
 
+// Rows [at, at + removed) were replaced by @added rows
+static void rowsReplaced(EditorRowChanges *changes, int at, int removed, int added)
+{
+  if (changes->start < 0)
+  {
+    changes->start = at;
+    changes->end   = at + added;
+    return;
+  }
+
+  if (at < changes->start)
+    changes->start = at;
+  if (changes->end > at + removed)
+    changes->end += added - removed;
+  else
+    changes->end = at + added;
+}
+
+static void editorTrackRows(EditorFile *file, int at, int removed, int added)
+{
+  rowsReplaced(&file->undo.changes, at, removed, added);
+  for (size_t i = 0; i < file->snapshots.size; i++)
+    rowsReplaced(&file->snapshots.data[i]->changes, at, removed, added);
+}
+
+// The content of a row in the row array changed
+static void editorRowChanged(EditorFile *file, EditorRow *row)
+{
+  int at    = row - file->row;
+  row->hash = 0;
+  indexSet(file, at, row);
+  editorTrackRows(file, at, 1, 1);
+}
+
 void editorUpdateRow(EditorFile *file, EditorRow *row)
 {
   row->rsize = editorRowCxToRx(row, row->size);
@@ -50,31 +349,92 @@ void editorInsertRow(EditorFile *file, int at, const char *s, size_t len)
   size_t new_capacity;
   if (ensureCapacity(file->row_capacity, file->num_rows + 1, &new_capacity))
   {
-    file->row = realloc_s(file->row, sizeof(EditorRow) * new_capacity);
+    file->row          = realloc_s(file->row, sizeof(EditorRow) * new_capacity);
+    file->row_capacity = new_capacity;
   }
 
   memmove(&file->row[at + 1], &file->row[at], sizeof(EditorRow) * (file->num_rows - at));
   memset(&file->row[at], 0, sizeof(EditorRow));
+  file->num_rows++;
+  indexInsert(file, at, 1);
+  editorTrackRows(file, at, 0, 1);
+
   editorRowAppendString(file, &file->row[at], s, len);
+  file->licore_width = getDigit(file->num_rows) + 2;
+}
+
+void editorInsertRows(EditorFile *file, int at, const Str *lines, int count)
+{
+  if (at < 0 || at > file->num_rows || count <= 0)
+    return;
+
+  size_t new_capacity;
+  if (ensureCapacity(file->row_capacity, file->num_rows + count, &new_capacity))
+  {
+    file->row          = realloc_s(file->row, sizeof(EditorRow) * new_capacity);
+    file->row_capacity = new_capacity;
+  }
+
+  memmove(&file->row[at + count], &file->row[at], sizeof(EditorRow) * (file->num_rows - at));
+  memset(&file->row[at], 0, sizeof(EditorRow) * count);
+  file->num_rows += count;
+
+  for (int i = 0; i < count; i++)
+  {
+    EditorRow *row = &file->row[at + i];
+    row->gen       = file->gen;
+    if (lines[i].size)
+    {
+      row->data     = malloc_s(lines[i].size);
+      row->capacity = lines[i].size;
+      row->size     = lines[i].size;
+      memcpy(row->data, lines[i].data, lines[i].size);
+      file->bytes += lines[i].size;
+    }
+    row->rsize = editorRowCxToRx(row, row->size);
+  }
+  indexInsert(file, at, count);
+  editorTrackRows(file, at, 0, count);
+  editorUpdateSyntaxRange(file, at, at + count);
 
-  file->num_rows++;
   file->licore_width = getDigit(file->num_rows) + 2;
 }
 
-void editorFreeRow(EditorRow *row)
+void editorFreeRow(EditorFile *file, EditorRow *row)
 {
-  free(row->data);
-  free(row->hl);
+  file->bytes -= row->size;
+  editorRetireRow(file, row);
+  editorRowFreeSyntax(row);
 }
 
 void editorDelRow(EditorFile *file, int at)
 {
   if (at < 0 || at >= file->num_rows)
     return;
-  editorFreeRow(&file->row[at]);
+  editorFreeRow(file, &file->row[at]);
   memmove(&file->row[at], &file->row[at + 1], sizeof(EditorRow) * (file->num_rows - at - 1));
 
   file->num_rows--;
+  indexDelete(file, at, 1);
+  editorTrackRows(file, at, 1, 0);
+  file->licore_width = getDigit(file->num_rows) + 2;
+}
+
+void editorDelRows(EditorFile *file, int at, int count)
+{
+  if (at < 0 || count <= 0 || at + count > file->num_rows)
+    return;
+
+  for (int i = at; i < at + count; i++)
+  {
+    editorFreeRow(file, &file->row[i]);
+  }
+  memmove(&file->row[at], &file->row[at + count],
+          sizeof(EditorRow) * (file->num_rows - at - count));
+
+  file->num_rows -= count;
+  indexDelete(file, at, count);
+  editorTrackRows(file, at, count, 0);
   file->licore_width = getDigit(file->num_rows) + 2;
 }
 
@@ -82,10 +442,14 @@ void editorRowInsertChar(EditorFile *file, EditorRow *row, int at, int c)
 {
   if (at < 0 || at > row->size)
     return;
+  editorRowDetach(file, row);
   editorRowEnsureCapacity(row, row->size + 1);
+  editorRowInvalidateSyntax(row, at);
   memmove(&row->data[at + 1], &row->data[at], row->size - at);
   row->size++;
   row->data[at] = c;
+  file->bytes++;
+  editorRowChanged(file, row);
   editorUpdateRow(file, row);
 }
 
@@ -93,16 +457,37 @@ void editorRowDelChar(EditorFile *file, EditorRow *row, int at)
 {
   if (at < 0 || at >= row->size)
     return;
+  editorRowDetach(file, row);
+  editorRowInvalidateSyntax(row, at);
   memmove(&row->data[at], &row->data[at + 1], row->size - at - 1);
   row->size--;
+  file->bytes--;
+  editorRowChanged(file, row);
+  editorUpdateRow(file, row);
+}
+
+void editorRowDelString(EditorFile *file, EditorRow *row, int at, size_t len)
+{
+  if (at < 0 || at + (int) len > row->size)
+    return;
+  editorRowDetach(file, row);
+  editorRowInvalidateSyntax(row, at);
+  memmove(&row->data[at], &row->data[at + len], row->size - at - len);
+  row->size -= len;
+  file->bytes -= len;
+  editorRowChanged(file, row);
   editorUpdateRow(file, row);
 }
 
 void editorRowAppendString(EditorFile *file, EditorRow *row, const char *s, size_t len)
 {
+  editorRowDetach(file, row);
   editorRowEnsureCapacity(row, row->size + len);
+  editorRowInvalidateSyntax(row, row->size);
   memcpy(&row->data[row->size], s, len);
   row->size += len;
+  file->bytes += len;
+  editorRowChanged(file, row);
   editorUpdateRow(file, row);
 }
 
@@ -111,13 +496,170 @@ void editorRowInsertString(EditorFile *file, EditorRow *row, int at, const char
   if (at < 0 || at > row->size)
     return;
 
+  editorRowDetach(file, row);
   editorRowEnsureCapacity(row, row->size + len);
+  editorRowInvalidateSyntax(row, at);
   memmove(&row->data[at + len], &row->data[at], row->size - at);
   memcpy(&row->data[at], s, len);
   row->size += len;
+  file->bytes += len;
+  editorRowChanged(file, row);
   editorUpdateRow(file, row);
 }
 
+// Drop the end of a row, the caller updates it afterwards
+void editorRowTruncate(EditorFile *file, EditorRow *row, int at)
+{
+  if (at < 0 || at > row->size)
+    return;
+  editorRowInvalidateSyntax(row, at);
+  file->bytes -= row->size - at;
+  row->size = at;
+  editorRowChanged(file, row);
+}
+
+static uint64_t hashRow(const char *data, int size)
+{
+  uint64_t hash = hashBytes(HASH_INIT, data, size);
+  return hash ? hash : 1;
+}
+
+// Fold the hash of the next row into the hash of the file
+static inline uint64_t hashCombine(uint64_t hash, uint64_t row_hash)
+{
+  hash = (hash ^ row_hash) * 0x100000001b3ULL;
+  return hash ^ (hash >> 32);
+}
+
+// Hash of a row, kept until the row changes
+uint64_t editorRowHash(EditorRow *row)
+{
+  if (!row->hash)
+    row->hash = hashRow(row->data, row->size);
+  return row->hash;
+}
+
+/**
+ * editorHashFile - Content hash of a file
+ * @file: The file
+ *
+ * Each row is hashed once and kept until it changes, later calls only
+ * combine the row hashes.
+ *
+ * Returns: The hash, equal to editorHashSnapshot() of the same content
+ */
+uint64_t editorHashFile(EditorFile *file)
+{
+  uint64_t hash = HASH_INIT;
+  for (int i = 0; i < file->num_rows; i++)
+    hash = hashCombine(hash, editorRowHash(&file->row[i]));
+  uint8_t newline = file->newline;
+  return hashBytes(hash, &newline, 1);
+}
+
+/**
+ * editorHashSnapshot - Content hash of a snapshot
+ * @snapshot: The snapshot
+ *
+ * Safe to call from another thread. The row hashes are kept in
+ * @snapshot->row_hashes.
+ *
+ * Returns: The hash, equal to editorHashFile() of the same content
+ */
+uint64_t editorHashSnapshot(EditorSnapshot *snapshot)
+{
+  const EditorRowIndex *index      = snapshot->index;
+  int                   count      = snapshot->num_rows ? snapshot->num_rows : 1;
+  uint64_t             *row_hashes = malloc_s(sizeof(uint64_t) * count);
+  uint64_t              hash       = HASH_INIT;
+
+  int at = 0;
+  for (int n = 0; n < index->num_chunks; n++)
+  {
+    const EditorRowChunk *chunk = index->chunks[n];
+    for (int i = 0; i < chunk->count; i++, at++)
+    {
+      row_hashes[at] = hashRow(chunk->rows[i].data, chunk->rows[i].size);
+      hash           = hashCombine(hash, row_hashes[at]);
+    }
+  }
+  snapshot->row_hashes = row_hashes;
+  return hashBytes(hash, &snapshot->newline, 1);
+}
+
+/**
+ * editorTakeSnapshot - Take a read-only view of the content of a file
+ * @file: The file
+ *
+ * Takes constant time: the snapshot holds the row index of the file and
+ * starts a new generation, row buffers from older generations are copied
+ * before the file modifies them. Several snapshots can be alive at once.
+ *
+ * Returns: The snapshot, release it with editorReleaseSnapshot()
+ */
+EditorSnapshot *editorTakeSnapshot(EditorFile *file)
+{
+  if (!file->index)
+    indexUnique(file);
+
+  EditorSnapshot *snapshot = malloc_s(sizeof(EditorSnapshot));
+  memset(snapshot, 0, sizeof(EditorSnapshot));
+  snapshot->index    = file->index;
+  snapshot->num_rows = file->num_rows;
+  snapshot->bytes    = file->bytes;
+  snapshot->newline  = file->newline;
+  snapshot->gen      = ++file->gen;
+  snapshot->changes  = ROWS_UNCHANGED;
+  file->index->refs++;
+
+  vector_push(file->snapshots, snapshot);
+  return snapshot;
+}
+
+void editorReleaseSnapshot(EditorFile *file, EditorSnapshot *snapshot)
+{
+  size_t at = 0;
+  while (at < file->snapshots.size && file->snapshots.data[at] != snapshot)
+    at++;
+  if (at == file->snapshots.size)
+    return;
+
+  memmove(&file->snapshots.data[at], &file->snapshots.data[at + 1],
+          sizeof(EditorSnapshot *) * (file->snapshots.size - at - 1));
+  file->snapshots.size--;
+
+  editorReleaseRowIndex(snapshot->index);
+  free(snapshot->row_hashes);
+  free(snapshot);
+
+  // Free the retired buffers no remaining snapshot can read
+  size_t kept = 0;
+  for (size_t i = 0; i < file->retired.size; i++)
+  {
+    EditorRetiredRow retired = file->retired.data[i];
+    bool             used    = false;
+    for (size_t j = 0; j < file->snapshots.size && !used; j++)
+    {
+      uint32_t gen = file->snapshots.data[j]->gen;
+      used         = retired.born < gen && gen <= retired.died;
+    }
+
+    if (used)
+      file->retired.data[kept++] = retired;
+    else
+      free(retired.data);
+  }
+  file->retired.size = kept;
+}
+
+// Data and size of row @at of a snapshot
+Str editorSnapshotRow(const EditorSnapshot *snapshot, int at)
+{
+  const EditorRowIndex *index = snapshot->index;
+  int                   n     = indexFind(index, at);
+  return index->chunks[n]->rows[at - index->starts[n]];
+}
+
 void editorInsertChar(int c)
 {
   if (gCurFile->cursor.y == gCurFile->num_rows)
@@ -191,7 +733,7 @@ void editorInsertNewline(void)
     }
     editorRowAppendString(gCurFile, new_row, &curr_row->data[gCurFile->cursor.x],
                           curr_row->size - gCurFile->cursor.x);
-    curr_row->size = gCurFile->cursor.x;
+    editorRowTruncate(gCurFile, curr_row, gCurFile->cursor.x);
     editorUpdateRow(gCurFile, curr_row);
   }
   gCurFile->cursor.y++;
@@ -1,27 +1,151 @@
 #ifndef ROW_H
 #define ROW_H
 
+#include "core_utils.h"
+
 struct EditorFile;
 typedef struct EditorFile EditorFile;
 
+struct EditorHighlightWindow;
+
 typedef struct EditorRow
 {
-  int      size;
-  int      rsize;
-  char    *data;
-  size_t   capacity;
-  uint8_t *hl;
-  int      hl_open_comment;
+  int       size;
+  int       rsize;
+  char     *data;
+  size_t    capacity;
+  uint16_t *hl;
+  int       hl_runs;
+  int       hl_open_comment;
+
+  struct EditorHighlightWindow *hl_window;
+
+  // Generation data was allocated in, see editorTakeSnapshot()
+  uint32_t gen;
+
+  // Content hash of data, 0 if not computed since the last change
+  uint64_t hash;
 } EditorRow;
 
+/**
+ * struct EditorRowChanges - Rows that were changed since an earlier version
+ * @start: First row that may differ, -1 if nothing changed
+ * @end: End of the rows that may differ, the rows from here on match the
+ *       rows of the earlier version that are as far from its end
+ *
+ * Comparing a file with an earlier version only needs to look at these rows.
+ */
+typedef struct EditorRowChanges
+{
+  int start;
+  int end;
+} EditorRowChanges;
+
+#define ROWS_UNCHANGED ((EditorRowChanges) {-1, -1})
+
+// Rows in a chunk of the row index
+#define ROW_CHUNK_SIZE 1024
+
+/**
+ * struct EditorRowChunk - Consecutive rows of a row index
+ * @refs: Number of indexes holding the chunk
+ * @count: Rows in the chunk
+ * @rows: Data and size of each row
+ */
+typedef struct EditorRowChunk
+{
+  int refs;
+  int count;
+  Str rows[ROW_CHUNK_SIZE];
+} EditorRowChunk;
+
+/**
+ * struct EditorRowIndex - Data and size of every row of a file
+ * @refs: Number of holders, the file and its snapshots
+ * @num_chunks: Chunks in use
+ * @capacity: Allocated chunk slots
+ * @chunks: The chunks in row order, none of them empty
+ * @starts: Number of the first row of each chunk
+ *
+ * The file keeps the index next to its row array and shares it with its
+ * snapshots. Before a change the file copies the index if it is shared,
+ * then the chunk the change is in, so a snapshot is taken in constant
+ * time and an edit copies at most one chunk.
+ */
+typedef struct EditorRowIndex
+{
+  int              refs;
+  int              num_chunks;
+  size_t           capacity;
+  EditorRowChunk **chunks;
+  int             *starts;
+} EditorRowIndex;
+
+/**
+ * struct EditorRetiredRow - Row buffer the file stopped using
+ * @data: The buffer
+ * @born: Generation the buffer was allocated in
+ * @died: Generation the buffer was replaced or freed in
+ *
+ * Snapshots of the generations after @born up to @died may still read it.
+ */
+typedef struct EditorRetiredRow
+{
+  char    *data;
+  uint32_t born;
+  uint32_t died;
+} EditorRetiredRow;
+
+/**
+ * struct EditorSnapshot - Read-only view of the content of a file
+ * @index: Data and size of each row
+ * @num_rows: Number of rows
+ * @bytes: Bytes in all rows, newlines not counted
+ * @newline: Newline of the file
+ * @gen: Generation of the file started by this snapshot
+ * @changes: Rows of the file changed since the snapshot was taken
+ * @row_hashes: Hash of each row, see editorHashSnapshot()
+ *
+ * The index points at the row buffers of the file. A row whose buffer is
+ * older than the newest snapshot is copied before it is modified, and the
+ * old buffer is retired instead of freed until no snapshot can read it.
+ * A background thread can read the snapshot while the file is edited.
+ */
+typedef struct EditorSnapshot
+{
+  EditorRowIndex *index;
+  int             num_rows;
+  size_t          bytes;
+  uint8_t         newline;
+  uint32_t        gen;
+
+  EditorRowChanges changes;
+  uint64_t        *row_hashes;
+} EditorSnapshot;
+
 void editorUpdateRow(EditorFile *file, EditorRow *row);
 void editorInsertRow(EditorFile *file, int at, const char *s, size_t len);
-void editorFreeRow(EditorRow *row);
+void editorInsertRows(EditorFile *file, int at, const Str *lines, int count);
+void editorFreeRow(EditorFile *file, EditorRow *row);
 void editorDelRow(EditorFile *file, int at);
+void editorDelRows(EditorFile *file, int at, int count);
 void editorRowInsertChar(EditorFile *file, EditorRow *row, int at, int c);
 void editorRowDelChar(EditorFile *file, EditorRow *row, int at);
+void editorRowDelString(EditorFile *file, EditorRow *row, int at, size_t len);
 void editorRowAppendString(EditorFile *file, EditorRow *row, const char *s, size_t len);
 void editorRowInsertString(EditorFile *file, EditorRow *row, int at, const char *s, size_t len);
+void editorRowTruncate(EditorFile *file, EditorRow *row, int at);
+
+// Content hash, the same for a file and a snapshot of it
+uint64_t editorRowHash(EditorRow *row);
+uint64_t editorHashFile(EditorFile *file);
+uint64_t editorHashSnapshot(EditorSnapshot *snapshot);
+
+// Snapshots
+EditorSnapshot *editorTakeSnapshot(EditorFile *file);
+void            editorReleaseSnapshot(EditorFile *file, EditorSnapshot *snapshot);
+Str             editorSnapshotRow(const EditorSnapshot *snapshot, int at);
+void            editorReleaseRowIndex(EditorRowIndex *index);
 
 // On gCurFile
 void editorInsertChar(int c);
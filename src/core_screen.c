@@ -0,0 +1,500 @@
+#include "core_screen.h"
+
+#include "core_editor.h"
+#include "core_os.h"
+#include "core_terminal.h"
+#include "core_unicode.h"
+
+// Unchanged cells are written again instead of moving the cursor over them
+// when there are at most this many
+#define SCREEN_REWRITE_MAX 4
+
+// A changed blank tail of a row is cleared with ANSI_ERASE_LINE when more
+// than this many of its cells changed
+#define SCREEN_ERASE_MIN 3
+
+/**
+ * struct EditorScreen - Renderer state
+ * @rows: Screen height
+ * @cols: Screen width
+ * @front: Cells the terminal is showing
+ * @back: Cells of the frame being drawn
+ * @front_valid: @front matches the terminal
+ * @x: Drawing column (0-based)
+ * @y: Drawing row (0-based)
+ * @fg: Drawing foreground color
+ * @bg: Drawing background color
+ * @attr: Drawing attributes
+ * @cursor_x: Requested cursor column (0-based)
+ * @cursor_y: Requested cursor row (0-based)
+ * @cursor_visible: Requested cursor visibility
+ * @term_x: Terminal cursor column, -1 if unknown
+ * @term_y: Terminal cursor row, -1 if unknown
+ * @term_cursor_visible: Terminal cursor visibility
+ * @term_fg: Terminal foreground color
+ * @term_bg: Terminal background color
+ * @term_attr: Terminal attributes
+ * @stats: Output statistics
+ */
+typedef struct EditorScreen
+{
+  int               rows;
+  int               cols;
+  EditorScreenCell *front;
+  EditorScreenCell *back;
+  bool              front_valid;
+
+  int     x;
+  int     y;
+  uint8_t fg;
+  uint8_t bg;
+  uint8_t attr;
+
+  int  cursor_x;
+  int  cursor_y;
+  bool cursor_visible;
+
+  int     term_x;
+  int     term_y;
+  bool    term_cursor_visible;
+  uint8_t term_fg;
+  uint8_t term_bg;
+  uint8_t term_attr;
+
+  EditorScreenStats stats;
+} EditorScreen;
+
+static EditorScreen screen;
+
+/**
+ * screenSGR - Get the escape sequence selecting a palette slot
+ * @slot: Palette slot
+ * @is_bg: Background instead of foreground
+ * @len: Receives the length of the sequence
+ *
+ * Returns: The precomputed sequence
+ */
+static const char *screenSGR(uint8_t slot, bool is_bg, size_t *len)
+{
+  if (slot == SCREEN_COLOR_DEFAULT)
+  {
+    *len = is_bg ? sizeof(ANSI_DEFAULT_BG) - 1 : sizeof(ANSI_DEFAULT_FG) - 1;
+    return is_bg ? ANSI_DEFAULT_BG : ANSI_DEFAULT_FG;
+  }
+
+  const EditorColorSGR *sgr = &gEditor.color_sgr[slot];
+  *len                      = is_bg ? sgr->bg_len : sgr->fg_len;
+  return is_bg ? sgr->bg : sgr->fg;
+}
+
+// Different slots may still select the same color on the terminal
+static bool sameColor(uint8_t a, uint8_t b, bool is_bg)
+{
+  if (a == b)
+    return true;
+
+  size_t      a_len, b_len;
+  const char *a_seq = screenSGR(a, is_bg, &a_len);
+  const char *b_seq = screenSGR(b, is_bg, &b_len);
+  return a_len == b_len && memcmp(a_seq, b_seq, a_len) == 0;
+}
+
+// A space without attributes, its foreground color is never visible
+static inline bool isBlankCell(const EditorScreenCell *cell)
+{
+  return cell->len == 1 && cell->glyph[0] == ' ' && !cell->attr;
+}
+
+static bool cellEqual(const EditorScreenCell *a, const EditorScreenCell *b)
+{
+  return a->len == b->len && a->width == b->width && a->attr == b->attr &&
+         a->fg == b->fg && a->bg == b->bg && memcmp(a->glyph, b->glyph, a->len) == 0;
+}
+
+static void setBlankCell(EditorScreenCell *cell, uint8_t bg)
+{
+  cell->glyph[0] = ' ';
+  cell->len      = 1;
+  cell->width    = 1;
+  cell->attr     = 0;
+  cell->fg       = SCREEN_COLOR_DEFAULT;
+  cell->bg       = bg;
+}
+
+void editorScreenBegin(int rows, int cols)
+{
+  if (rows != screen.rows || cols != screen.cols || !screen.back)
+  {
+    size_t size        = (size_t) rows * cols * sizeof(EditorScreenCell);
+    screen.front       = realloc_s(screen.front, size);
+    screen.back        = realloc_s(screen.back, size);
+    screen.rows        = rows;
+    screen.cols        = cols;
+    screen.front_valid = false;
+  }
+
+  for (int i = 0; i < rows * cols; i++)
+    setBlankCell(&screen.back[i], SCREEN_COLOR_DEFAULT);
+
+  screen.x    = 0;
+  screen.y    = 0;
+  screen.fg   = SCREEN_COLOR_DEFAULT;
+  screen.bg   = SCREEN_COLOR_DEFAULT;
+  screen.attr = 0;
+
+  screen.cursor_visible = false;
+}
+
+void editorScreenGoto(int row, int col)
+{
+  screen.y = (row < 1) ? 0 : row - 1;
+  screen.x = (col < 1) ? 0 : col - 1;
+}
+
+void editorScreenSetColor(uint8_t slot, int is_bg)
+{
+  if (is_bg)
+    screen.bg = slot;
+  else
+    screen.fg = slot;
+}
+
+void editorScreenResetColor(void)
+{
+  screen.fg   = SCREEN_COLOR_DEFAULT;
+  screen.bg   = SCREEN_COLOR_DEFAULT;
+  screen.attr = 0;
+}
+
+void editorScreenSetInvert(bool invert)
+{
+  if (invert)
+    screen.attr |= SCREEN_ATTR_INVERT;
+  else
+    screen.attr &= ~SCREEN_ATTR_INVERT;
+}
+
+void editorScreenPutN(const char *s, size_t n)
+{
+  if (screen.y >= screen.rows)
+    return;
+
+  EditorScreenCell *row = &screen.back[screen.y * screen.cols];
+
+  size_t i = 0;
+  while (i < n)
+  {
+    size_t   byte_size;
+    uint32_t unicode = decodeUTF8(&s[i], n - i, &byte_size);
+    int      width   = unicodeWidth(unicode);
+    if (byte_size == 0)
+      break;
+
+    if (width < 0 || byte_size > SCREEN_GLYPH_MAX)
+    {
+      // Control characters would move the terminal cursor
+      i += byte_size;
+      continue;
+    }
+
+    if (width == 0)
+    {
+      // Combining mark, attach it to the previous character
+      int prev = screen.x - 1;
+      while (prev >= 0 && prev < screen.cols && row[prev].len == 0)
+        prev--;
+      if (prev >= 0 && prev < screen.cols && row[prev].len + byte_size <= SCREEN_GLYPH_MAX)
+      {
+        memcpy(&row[prev].glyph[row[prev].len], &s[i], byte_size);
+        row[prev].len += byte_size;
+      }
+      i += byte_size;
+      continue;
+    }
+
+    if (screen.x + width > screen.cols)
+      break;
+
+    // Overwriting half of a wide character leaves a blank in the other half
+    if (row[screen.x].len == 0 && screen.x > 0)
+      setBlankCell(&row[screen.x - 1], row[screen.x - 1].bg);
+    if (screen.x + width < screen.cols && row[screen.x + width].len == 0)
+      setBlankCell(&row[screen.x + width], row[screen.x + width].bg);
+
+    EditorScreenCell *cell = &row[screen.x];
+    memcpy(cell->glyph, &s[i], byte_size);
+    cell->len   = byte_size;
+    cell->width = width;
+    cell->attr  = screen.attr;
+    cell->fg    = screen.fg;
+    cell->bg    = screen.bg;
+    if (isBlankCell(cell))
+      cell->fg = SCREEN_COLOR_DEFAULT;
+
+    if (width == 2)
+    {
+      row[screen.x + 1]       = *cell;
+      row[screen.x + 1].len   = 0;
+      row[screen.x + 1].width = 0;
+    }
+
+    screen.x += width;
+    i += byte_size;
+  }
+}
+
+void editorScreenEraseLine(void)
+{
+  if (screen.y >= screen.rows)
+    return;
+
+  EditorScreenCell *row = &screen.back[screen.y * screen.cols];
+  if (screen.x < screen.cols && row[screen.x].len == 0 && screen.x > 0)
+    setBlankCell(&row[screen.x - 1], row[screen.x - 1].bg);
+
+  for (int x = screen.x; x < screen.cols; x++)
+    setBlankCell(&row[x], screen.bg);
+}
+
+void editorScreenSetCursor(int row, int col, bool visible)
+{
+  screen.cursor_y       = row - 1;
+  screen.cursor_x       = col - 1;
+  screen.cursor_visible = visible;
+}
+
+/**
+ * screenSetPen - Switch the terminal to the colors of a cell
+ * @ab: Output buffer
+ * @cell: The cell about to be written
+ */
+static void screenSetPen(abuf *ab, const EditorScreenCell *cell)
+{
+  if (cell->attr != screen.term_attr)
+  {
+    if (cell->attr & SCREEN_ATTR_INVERT)
+      abufAppendStr(ab, ANSI_INVERT);
+    else
+      abufAppendStr(ab, ANSI_NOT_INVERT);
+    screen.term_attr = cell->attr;
+  }
+
+  size_t      len;
+  const char *seq;
+
+  // The foreground of a blank cell doesn't matter
+  if (!isBlankCell(cell) && !sameColor(cell->fg, screen.term_fg, false))
+  {
+    seq = screenSGR(cell->fg, false, &len);
+    abufAppendN(ab, seq, len);
+    screen.term_fg = cell->fg;
+  }
+
+  if (!sameColor(cell->bg, screen.term_bg, true))
+  {
+    seq = screenSGR(cell->bg, true, &len);
+    abufAppendN(ab, seq, len);
+    screen.term_bg = cell->bg;
+  }
+}
+
+/**
+ * screenMoveTo - Move the terminal cursor
+ * @ab: Output buffer
+ * @x: Column (0-based)
+ * @y: Row (0-based)
+ *
+ * Picks the shortest of rewriting the cells in between (only when they
+ * are unchanged and use the current colors), a relative move to the
+ * right, or an absolute move.
+ */
+static void screenMoveTo(abuf *ab, int x, int y)
+{
+  if (screen.term_x == x && screen.term_y == y)
+    return;
+
+  char buf[32];
+  int  len = snprintf(buf, sizeof(buf), "\x1b[%d;%dH", y + 1, x + 1);
+
+  if (screen.term_y == y && screen.term_x >= 0 && screen.term_x < x)
+  {
+    int gap = x - screen.term_x;
+
+    char rel[32];
+    int  rel_len = (gap == 1) ? snprintf(rel, sizeof(rel), "\x1b[C")
+                              : snprintf(rel, sizeof(rel), "\x1b[%dC", gap);
+    if (rel_len < len)
+    {
+      memcpy(buf, rel, rel_len);
+      len = rel_len;
+    }
+
+    if (gap <= SCREEN_REWRITE_MAX)
+    {
+      const EditorScreenCell *row = &screen.front[y * screen.cols];
+
+      int  rewrite_len = 0;
+      bool can_rewrite = (row[screen.term_x].len != 0);
+      for (int i = screen.term_x; i < x && can_rewrite; i++)
+      {
+        const EditorScreenCell *cell = &row[i];
+        can_rewrite = cell->attr == screen.term_attr &&
+                      sameColor(cell->bg, screen.term_bg, true) &&
+                      (isBlankCell(cell) || sameColor(cell->fg, screen.term_fg, false));
+        rewrite_len += cell->len;
+      }
+      // A wide character must not be cut in half
+      if (can_rewrite && row[x].len == 0)
+        can_rewrite = false;
+
+      if (can_rewrite && rewrite_len <= len)
+      {
+        for (int i = screen.term_x; i < x; i++)
+          abufAppendN(ab, row[i].glyph, row[i].len);
+        screen.term_x = x;
+        return;
+      }
+    }
+  }
+
+  abufAppendN(ab, buf, len);
+  screen.term_x = x;
+  screen.term_y = y;
+}
+
+/**
+ * screenBlankTail - Find where the blank tail of a row starts
+ * @row: The row
+ *
+ * Returns: First column from which every cell is blank with the background
+ *          of the last cell, screen.cols if the last cell isn't blank
+ */
+static int screenBlankTail(const EditorScreenCell *row)
+{
+  int x = screen.cols;
+  while (x > 0 && isBlankCell(&row[x - 1]) && row[x - 1].bg == row[screen.cols - 1].bg)
+    x--;
+  return x;
+}
+
+void editorScreenFlush(void)
+{
+  abuf   ab    = ABUF_INIT;
+  size_t cells = 0;
+
+  if (!screen.front_valid)
+  {
+    // Unknown terminal state
+    abufAppendStr(&ab, ANSI_CLEAR);
+    screen.term_fg             = SCREEN_COLOR_DEFAULT;
+    screen.term_bg             = SCREEN_COLOR_DEFAULT;
+    screen.term_attr           = 0;
+    screen.term_x              = -1;
+    screen.term_y              = -1;
+    screen.term_cursor_visible = true;
+  }
+
+  for (int y = 0; y < screen.rows; y++)
+  {
+    EditorScreenCell *back  = &screen.back[y * screen.cols];
+    EditorScreenCell *front = &screen.front[y * screen.cols];
+    int               blank = screenBlankTail(back);
+
+    int x = 0;
+    while (x < screen.cols)
+    {
+      int step = back[x].width ? back[x].width : 1;
+      if (screen.front_valid && cellEqual(&back[x], &front[x]) &&
+          (step == 1 || cellEqual(&back[x + 1], &front[x + 1])))
+      {
+        x += step;
+        continue;
+      }
+
+      // Hide the cursor while drawing
+      if (screen.term_cursor_visible)
+      {
+        abufAppendStr(&ab, ANSI_CURSOR_HIDE);
+        screen.term_cursor_visible = false;
+      }
+
+      if (x >= blank)
+      {
+        int changed = 0;
+        for (int i = x; i < screen.cols; i++)
+        {
+          if (!screen.front_valid || !cellEqual(&back[i], &front[i]))
+            changed++;
+        }
+
+        if (changed > SCREEN_ERASE_MIN)
+        {
+          screenMoveTo(&ab, x, y);
+          screenSetPen(&ab, &back[x]);
+          abufAppendStr(&ab, ANSI_ERASE_LINE);
+          memcpy(&front[x], &back[x], sizeof(EditorScreenCell) * (screen.cols - x));
+          cells += changed;
+          break;
+        }
+      }
+
+      screenMoveTo(&ab, x, y);
+      screenSetPen(&ab, &back[x]);
+      abufAppendN(&ab, back[x].glyph, back[x].len);
+      memcpy(&front[x], &back[x], sizeof(EditorScreenCell) * step);
+      cells++;
+
+      // Writing the last column leaves the cursor in an unreliable state
+      screen.term_x += step;
+      if (screen.term_x >= screen.cols)
+        screen.term_x = -1;
+
+      x += step;
+    }
+  }
+  screen.front_valid = true;
+
+  if (screen.cursor_visible)
+  {
+    screenMoveTo(&ab, screen.cursor_x, screen.cursor_y);
+    if (!screen.term_cursor_visible)
+      abufAppendStr(&ab, ANSI_CURSOR_SHOW);
+  }
+  else if (screen.term_cursor_visible)
+  {
+    abufAppendStr(&ab, ANSI_CURSOR_HIDE);
+  }
+  screen.term_cursor_visible = screen.cursor_visible;
+
+  if (ab.len)
+    writeConsoleAll(ab.buf, ab.len);
+  else
+    screen.stats.empty_frames++;
+
+  screen.stats.frames++;
+  screen.stats.last_bytes = ab.len;
+  screen.stats.last_cells = cells;
+  screen.stats.total_bytes += ab.len;
+  if (ab.len > screen.stats.max_bytes)
+    screen.stats.max_bytes = ab.len;
+
+  abufFree(&ab);
+}
+
+void editorScreenInvalidate(void)
+{
+  screen.front_valid = false;
+}
+
+const EditorScreenStats *editorScreenGetStats(void)
+{
+  return &screen.stats;
+}
+
+void editorScreenFree(void)
+{
+  free(screen.front);
+  free(screen.back);
+  screen.front = NULL;
+  screen.back  = NULL;
+}
@@ -0,0 +1,153 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include "core_utils.h"
+
+/**
+ * SCREEN_COLOR_DEFAULT - Palette slot of the terminal's default color
+ *
+ * Other colors are slots of EditorColorScheme, see COLOR_SLOT().
+ */
+#define SCREEN_COLOR_DEFAULT 0xFF
+
+// Cell attributes
+#define SCREEN_ATTR_INVERT (1 << 0)
+
+// Maximum bytes of a cell: one character plus a combining mark
+#define SCREEN_GLYPH_MAX 8
+
+/**
+ * struct EditorScreenCell - A single character cell of the terminal
+ * @glyph: UTF-8 bytes of the character
+ * @len: Number of bytes in @glyph, 0 for the right half of a wide character
+ * @width: Display width (1 or 2), 0 for the right half of a wide character
+ * @attr: SCREEN_ATTR_* flags
+ * @fg: Foreground palette slot
+ * @bg: Background palette slot
+ */
+typedef struct EditorScreenCell
+{
+  char    glyph[SCREEN_GLYPH_MAX];
+  uint8_t len;
+  uint8_t width;
+  uint8_t attr;
+  uint8_t fg;
+  uint8_t bg;
+} EditorScreenCell;
+
+/**
+ * struct EditorScreenStats - Output statistics of the renderer
+ * @frames: Number of frames flushed
+ * @empty_frames: Frames that didn't need to write anything
+ * @last_bytes: Bytes written by the last frame
+ * @last_cells: Cells emitted by the last frame
+ * @max_bytes: Largest frame in bytes
+ * @total_bytes: Bytes written by all frames
+ */
+typedef struct EditorScreenStats
+{
+  size_t frames;
+  size_t empty_frames;
+  size_t last_bytes;
+  size_t last_cells;
+  size_t max_bytes;
+  size_t total_bytes;
+} EditorScreenStats;
+
+/**
+ * editorScreenBegin - Start drawing a new frame
+ * @rows: Terminal height
+ * @cols: Terminal width
+ *
+ * Clears the back buffer. Every frame is drawn completely into the back
+ * buffer with the functions below, then editorScreenFlush() writes only
+ * the cells that differ from what the terminal is already showing.
+ *
+ * A size change invalidates the front buffer, so the next flush repaints
+ * everything.
+ */
+void editorScreenBegin(int rows, int cols);
+
+/**
+ * editorScreenGoto - Move the drawing position
+ * @row: Row (1-based)
+ * @col: Column (1-based)
+ */
+void editorScreenGoto(int row, int col);
+
+/**
+ * editorScreenSetColor - Set the color used for drawing
+ * @slot: Palette slot, COLOR_SLOT() of the scheme color or SCREEN_COLOR_DEFAULT
+ * @is_bg: Set the background instead of the foreground
+ */
+void editorScreenSetColor(uint8_t slot, int is_bg);
+
+/**
+ * editorScreenResetColor - Go back to default colors without attributes
+ */
+void editorScreenResetColor(void);
+
+/**
+ * editorScreenSetInvert - Swap foreground and background of drawn cells
+ * @invert: Enable or disable
+ */
+void editorScreenSetInvert(bool invert);
+
+/**
+ * editorScreenPutN - Draw text at the drawing position
+ * @s: UTF-8 text, control characters are skipped
+ * @n: Number of bytes
+ *
+ * Text past the right edge of the screen is dropped.
+ */
+void editorScreenPutN(const char *s, size_t n);
+
+#define editorScreenPutStr(s) editorScreenPutN((s), sizeof(s) - 1)
+
+/**
+ * editorScreenEraseLine - Clear from the drawing position to the end of the row
+ *
+ * Cleared cells get the current background color.
+ */
+void editorScreenEraseLine(void);
+
+/**
+ * editorScreenSetCursor - Set where the terminal cursor is shown
+ * @row: Row (1-based)
+ * @col: Column (1-based)
+ * @visible: Show or hide the cursor
+ */
+void editorScreenSetCursor(int row, int col, bool visible);
+
+/**
+ * editorScreenFlush - Write the changes of the frame to the terminal
+ *
+ * Compares the back buffer with the front buffer (the last state written
+ * to the terminal) and emits only the changed cells. Cursor movement to
+ * the next changed cell uses the cheapest of: rewriting a few unchanged
+ * cells, a relative move, or an absolute move. Changed blank tails of a
+ * row are cleared with a single erase sequence.
+ */
+void editorScreenFlush(void);
+
+/**
+ * editorScreenInvalidate - Forget what the terminal is showing
+ *
+ * Forces the next flush to repaint every cell, e.g. after the colors of
+ * the palette changed.
+ */
+void editorScreenInvalidate(void);
+
+/**
+ * editorScreenGetStats - Get output statistics
+ *
+ * Returns: Statistics since startup
+ */
+const EditorScreenStats *editorScreenGetStats(void);
+
+/**
+ * editorScreenFree - Free the cell buffers
+ */
+void editorScreenFree(void);
+
+#endif
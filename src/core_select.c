@@ -2,6 +2,7 @@
 
 #include "core_config.h"
 #include "core_editor.h"
+#include "core_highlight.h"
 #include "core_os.h"
 #include "core_row.h"
 #include "core_utils.h"
@@ -55,28 +56,40 @@ void editorDeleteText(EditorSelectRange range)
   if (range.start_x == range.end_x && range.start_y == range.end_y)
     return;
 
-  gCurFile->cursor.x = range.end_x;
-  gCurFile->cursor.y = range.end_y;
-
-  if (range.end_y - range.start_y > 1)
+  EditorRow *row = &gCurFile->row[range.start_y];
+  if (range.start_y == range.end_y)
   {
-    for (int i = range.start_y + 1; i < range.end_y; i++)
-    {
-      editorFreeRow(&gCurFile->row[i]);
-    }
-    int removed_rows = range.end_y - range.start_y - 1;
-    memmove(&gCurFile->row[range.start_y + 1], &gCurFile->row[range.end_y],
-            sizeof(EditorRow) * (gCurFile->num_rows - range.end_y));
-
-    gCurFile->num_rows -= removed_rows;
-    gCurFile->cursor.y -= removed_rows;
-
-    gCurFile->licore_width = getDigit(gCurFile->num_rows) + 2;
+    editorRowDelString(gCurFile, row, range.start_x, range.end_x - range.start_x);
   }
-  while (gCurFile->cursor.y != range.start_y || gCurFile->cursor.x != range.start_x)
+  else
   {
-    editorDelChar();
+    // Keep the last row until its tail is joined to the first row
+    EditorRow last = gCurFile->row[range.end_y];
+    memset(&gCurFile->row[range.end_y], 0, sizeof(EditorRow));
+    editorDelRows(gCurFile, range.start_y + 1, range.end_y - range.start_y);
+
+    row = &gCurFile->row[range.start_y];
+    editorRowTruncate(gCurFile, row, range.start_x);
+    editorRowAppendString(gCurFile, row, &last.data[range.end_x], last.size - range.end_x);
+    editorFreeRow(gCurFile, &last);
+
+    // The next row was highlighted after the deleted last row
+    if (range.start_y + 1 < gCurFile->num_rows)
+      editorUpdateSyntax(gCurFile, &gCurFile->row[range.start_y + 1]);
   }
+
+  gCurFile->cursor.x = range.start_x;
+  gCurFile->cursor.y = range.start_y;
+  gCurFile->sx       = editorRowCxToRx(row, range.start_x);
+}
+
+EditorTextBlock *editorNewTextBlock(char *data, Str *lines)
+{
+  EditorTextBlock *block = malloc_s(sizeof(EditorTextBlock));
+  block->refs            = 1;
+  block->data            = data;
+  block->lines           = lines;
+  return block;
 }
 
 void editorCopyText(EditorClipboard *clipboard, EditorSelectRange range)
@@ -85,44 +98,47 @@ void editorCopyText(EditorClipboard *clipboard, EditorSelectRange range)
   {
     clipboard->size  = 0;
     clipboard->lines = NULL;
+    clipboard->block = NULL;
     return;
   }
 
   clipboard->size  = range.end_y - range.start_y + 1;
   clipboard->lines = malloc_s(sizeof(Str) * clipboard->size);
-
-  size_t size;
+  clipboard->block = NULL;
 
   // Only one line
   if (range.start_y == range.end_y)
   {
-    size                     = range.end_x - range.start_x;
+    size_t size              = range.end_x - range.start_x;
     clipboard->lines[0].size = size;
     clipboard->lines[0].data = malloc_s(size);
-    memcpy(clipboard->lines[0].data, &gCurFile->row[range.start_y].data[range.start_x],
-           range.end_x - range.start_x);
+    memcpy(clipboard->lines[0].data, &gCurFile->row[range.start_y].data[range.start_x], size);
     return;
   }
 
-  // First line
-  size                     = gCurFile->row[range.start_y].size - range.start_x;
-  clipboard->lines[0].size = size;
-  clipboard->lines[0].data = malloc_s(size);
-  memcpy(clipboard->lines[0].data, &gCurFile->row[range.start_y].data[range.start_x], size);
+  // Several lines are copied into one block
+  size_t total = 0;
+  for (int i = range.start_y; i <= range.end_y; i++)
+  {
+    int start = (i == range.start_y) ? range.start_x : 0;
+    int end   = (i == range.end_y) ? range.end_x : gCurFile->row[i].size;
+    total += end - start;
+  }
 
-  // Middle
-  for (int i = range.start_y + 1; i < range.end_y; i++)
+  char  *data = malloc_s(total);
+  size_t at   = 0;
+  for (int i = range.start_y; i <= range.end_y; i++)
   {
-    size                                     = gCurFile->row[i].size;
-    clipboard->lines[i - range.start_y].size = size;
-    clipboard->lines[i - range.start_y].data = malloc_s(size);
-    memcpy(clipboard->lines[i - range.start_y].data, gCurFile->row[i].data, size);
+    int start = (i == range.start_y) ? range.start_x : 0;
+    int end   = (i == range.end_y) ? range.end_x : gCurFile->row[i].size;
+
+    Str *line  = &clipboard->lines[i - range.start_y];
+    line->size = end - start;
+    line->data = &data[at];
+    memcpy(line->data, &gCurFile->row[i].data[start], line->size);
+    at += line->size;
   }
-  // Last line
-  size                                               = range.end_x;
-  clipboard->lines[range.end_y - range.start_y].size = size;
-  clipboard->lines[range.end_y - range.start_y].data = malloc_s(size);
-  memcpy(clipboard->lines[range.end_y - range.start_y].data, gCurFile->row[range.end_y].data, size);
+  clipboard->block = editorNewTextBlock(data, clipboard->lines);
 }
 
 void editorCopyLine(EditorClipboard *clipboard, int row)
@@ -131,11 +147,13 @@ void editorCopyLine(EditorClipboard *clipboard, int row)
   {
     clipboard->size  = 0;
     clipboard->lines = NULL;
+    clipboard->block = NULL;
     return;
   }
 
   clipboard->size  = 2;
   clipboard->lines = malloc_s(sizeof(Str) * clipboard->size);
+  clipboard->block = NULL;
 
   // First line
   size_t size              = gCurFile->row[row].size;
@@ -167,40 +185,75 @@ void editorPasteText(const EditorClipboard *clipboard, int x, int y)
   }
   else
   {
+    int last = clipboard->size - 1;
+
+    // Middle and last line, all rows are inserted at once
+    editorInsertRows(gCurFile, y + 1, &clipboard->lines[1], last);
+
+    // The rest of the first row moves behind the last line
+    EditorRow *row = &gCurFile->row[y];
+    editorRowAppendString(gCurFile, &gCurFile->row[y + last], &row->data[x], row->size - x);
+
     // First line
-    int auto_indent           = CONVAR_GETINT(autoindent);
-    CONVAR_GETINT(autoindent) = 0;
-    editorInsertNewline();
-    CONVAR_GETINT(autoindent) = auto_indent;
-    editorRowAppendString(gCurFile, &gCurFile->row[y], clipboard->lines[0].data,
-                          clipboard->lines[0].size);
-    // Middle
-    for (size_t i = 1; i < clipboard->size - 1; i++)
+    editorRowTruncate(gCurFile, row, x);
+    editorRowAppendString(gCurFile, row, clipboard->lines[0].data, clipboard->lines[0].size);
+
+    gCurFile->cursor.y = y + last;
+    gCurFile->cursor.x = clipboard->lines[last].size;
+  }
+  gCurFile->sx = editorRowCxToRx(&gCurFile->row[gCurFile->cursor.y], gCurFile->cursor.x);
+}
+
+void editorShareClipboard(EditorClipboard *dst, EditorClipboard *src)
+{
+  // Move separately allocated lines into a block first
+  if (src->size && !src->block)
+  {
+    size_t total = 0;
+    for (size_t i = 0; i < src->size; i++)
+      total += src->lines[i].size;
+
+    char  *data = malloc_s(total);
+    size_t at   = 0;
+    for (size_t i = 0; i < src->size; i++)
     {
-      editorInsertRow(gCurFile, y + i, clipboard->lines[i].data, clipboard->lines[i].size);
+      memcpy(&data[at], src->lines[i].data, src->lines[i].size);
+      free(src->lines[i].data);
+      src->lines[i].data = &data[at];
+      at += src->lines[i].size;
     }
-    // Last line
-    EditorRow *row       = &gCurFile->row[y + clipboard->size - 1];
-    char      *paste     = clipboard->lines[clipboard->size - 1].data;
-    size_t     paste_len = clipboard->lines[clipboard->size - 1].size;
-    editorRowInsertString(gCurFile, row, 0, paste, paste_len);
-
-    gCurFile->cursor.y = y + clipboard->size - 1;
-    gCurFile->cursor.x = paste_len;
+    src->block = editorNewTextBlock(data, src->lines);
   }
-  gCurFile->sx = editorRowCxToRx(&gCurFile->row[gCurFile->cursor.y], gCurFile->cursor.x);
+
+  *dst = *src;
+  if (dst->block)
+    dst->block->refs++;
 }
 
 void editorFreeClipboardContent(EditorClipboard *clipboard)
 {
   if (!clipboard || !clipboard->size)
     return;
-  for (size_t i = 0; i < clipboard->size; i++)
+  if (clipboard->block)
   {
-    free(clipboard->lines[i].data);
+    if (--clipboard->block->refs == 0)
+    {
+      free(clipboard->block->data);
+      free(clipboard->block->lines);
+      free(clipboard->block);
+    }
+    clipboard->block = NULL;
+  }
+  else
+  {
+    for (size_t i = 0; i < clipboard->size; i++)
+    {
+      free(clipboard->lines[i].data);
+    }
+    free(clipboard->lines);
   }
-  clipboard->size = 0;
-  free(clipboard->lines);
+  clipboard->size  = 0;
+  clipboard->lines = NULL;
 }
 
 void editorCopyToSysClipboard(EditorClipboard *clipboard, uint8_t newline)
@@ -3,10 +3,24 @@
 
 #include "core_utils.h"
 
+/**
+ * struct EditorTextBlock - Immutable text shared by clipboards and undo steps
+ * @refs: Number of owners, the block is freed when the last one lets go
+ * @data: Text of all lines, back to back
+ * @lines: The lines, pointing into @data
+ */
+typedef struct EditorTextBlock
+{
+  int   refs;
+  char *data;
+  Str  *lines;
+} EditorTextBlock;
+
 typedef struct EditorClipboard
 {
-  size_t size;
-  Str   *lines;
+  size_t           size;
+  Str             *lines;
+  EditorTextBlock *block;  // If set, the lines belong to this shared block
 } EditorClipboard;
 
 typedef struct EditorSelectRange
@@ -25,7 +39,9 @@ void editorCopyText(EditorClipboard *clipboard, EditorSelectRange range);
 void editorCopyLine(EditorClipboard *clipboard, int row);
 void editorPasteText(const EditorClipboard *clipboard, int x, int y);
 
-void editorFreeClipboardContent(EditorClipboard *clipboard);
+EditorTextBlock *editorNewTextBlock(char *data, Str *lines);
+void             editorShareClipboard(EditorClipboard *dst, EditorClipboard *src);
+void             editorFreeClipboardContent(EditorClipboard *clipboard);
 
 void editorCopyToSysClipboard(EditorClipboard *clipboard, uint8_t newline);
 
@@ -0,0 +1,335 @@
+#include "core_task.h"
+
+#include "core_os.h"
+#include "core_output.h"
+#include "core_utils.h"
+
+// Most worker threads started, whatever the number of cores
+#define TASK_WORKERS_MAX 16
+
+// Time given to an idle task per slice
+#define IDLE_SLICE_US 8000
+
+// Tasks of one worker, oldest at head
+typedef struct TaskQueue
+{
+  Mutex       lock;
+  EditorTask *head;
+  EditorTask *tail;
+} TaskQueue;
+
+static struct
+{
+  bool   started;
+  int    count;    // Queues in use
+  int    running;  // Workers started, 0 if tasks run inline
+  int    next;     // Queue the next task goes to
+  Thread threads[TASK_WORKERS_MAX];
+
+  TaskQueue queues[TASK_WORKERS_MAX];
+
+  // Guards the fields below, taken after a queue lock if both are needed
+  Mutex       lock;
+  Cond        work;      // A task was queued or the pool stops
+  Cond        finished;  // A task finished
+  int         queued;
+  bool        quit;
+  EditorTask *finished_head;
+  EditorTask *finished_tail;
+} pool;
+
+static VECTOR(EditorIdleTask *) idle_tasks;
+static size_t idle_next;
+
+static void taskListAppend(EditorTask **head, EditorTask **tail, EditorTask *task)
+{
+  task->prev = *tail;
+  task->next = NULL;
+  if (*tail)
+    (*tail)->next = task;
+  else
+    *head = task;
+  *tail = task;
+}
+
+static void taskListRemove(EditorTask **head, EditorTask **tail, EditorTask *task)
+{
+  if (task->prev)
+    task->prev->next = task->next;
+  else
+    *head = task->next;
+  if (task->next)
+    task->next->prev = task->prev;
+  else
+    *tail = task->prev;
+  task->prev = NULL;
+  task->next = NULL;
+}
+
+// Take the oldest task of the worker's own queue, or steal one from the
+// queue of another worker
+static EditorTask *takeTask(int self)
+{
+  for (int i = 0; i < pool.count; i++)
+  {
+    TaskQueue *queue = &pool.queues[(self + i) % pool.count];
+
+    mutexLock(&queue->lock);
+    EditorTask *task = queue->head;
+    if (task)
+    {
+      taskListRemove(&queue->head, &queue->tail, task);
+      task->state = TASK_RUNNING;
+
+      mutexLock(&pool.lock);
+      pool.queued--;
+      mutexUnlock(&pool.lock);
+    }
+    mutexUnlock(&queue->lock);
+
+    if (task)
+      return task;
+  }
+  return NULL;
+}
+
+// Hand a task that ran over to the main thread, the task may be freed as
+// soon as the locks are released
+static void finishTask(EditorTask *task)
+{
+  TaskQueue *queue = &pool.queues[task->queue];
+  mutexLock(&queue->lock);
+  mutexLock(&pool.lock);
+  task->state = TASK_FINISHED;
+  taskListAppend(&pool.finished_head, &pool.finished_tail, task);
+  condBroadcast(&pool.finished);
+  mutexUnlock(&pool.lock);
+  mutexUnlock(&queue->lock);
+
+  wakeConsole();
+}
+
+static void taskWorker(void *arg)
+{
+  int self = (int) (intptr_t) arg;
+
+  for (;;)
+  {
+    EditorTask *task = takeTask(self);
+    if (task)
+    {
+      task->run(task->arg);
+      finishTask(task);
+      continue;
+    }
+
+    mutexLock(&pool.lock);
+    while (!pool.queued && !pool.quit)
+      condWait(&pool.work, &pool.lock);
+    bool quit = pool.quit;
+    mutexUnlock(&pool.lock);
+
+    if (quit)
+      return;
+  }
+}
+
+static void startWorkers(void)
+{
+  pool.started = true;
+  mutexInit(&pool.lock);
+  condInit(&pool.work);
+  condInit(&pool.finished);
+
+  // The main thread keeps a core for itself
+  pool.count = cpuCount() - 1;
+  if (pool.count < 1)
+    pool.count = 1;
+  if (pool.count > TASK_WORKERS_MAX)
+    pool.count = TASK_WORKERS_MAX;
+
+  for (int i = 0; i < pool.count; i++)
+    mutexInit(&pool.queues[i].lock);
+
+  while (pool.running < pool.count &&
+         threadStart(&pool.threads[pool.running], taskWorker, (void *) (intptr_t) pool.running))
+  {
+    pool.running++;
+  }
+}
+
+void editorStartTask(EditorTask *task)
+{
+  if (!pool.started)
+    startWorkers();
+
+  task->prev = NULL;
+  task->next = NULL;
+
+  if (!pool.running)
+  {
+    task->queue = 0;
+    task->run(task->arg);
+    mutexLock(&pool.lock);
+    task->state = TASK_FINISHED;
+    taskListAppend(&pool.finished_head, &pool.finished_tail, task);
+    mutexUnlock(&pool.lock);
+    return;
+  }
+
+  task->queue      = pool.next;
+  pool.next        = (pool.next + 1) % pool.count;
+  TaskQueue *queue = &pool.queues[task->queue];
+
+  mutexLock(&queue->lock);
+  task->state = TASK_QUEUED;
+  taskListAppend(&queue->head, &queue->tail, task);
+  mutexUnlock(&queue->lock);
+
+  mutexLock(&pool.lock);
+  pool.queued++;
+  condSignal(&pool.work);
+  mutexUnlock(&pool.lock);
+}
+
+void editorWaitTask(EditorTask *task)
+{
+  bool run_here = false;
+
+  if (pool.running)
+  {
+    TaskQueue *queue = &pool.queues[task->queue];
+    mutexLock(&queue->lock);
+    if (task->state == TASK_QUEUED)
+    {
+      taskListRemove(&queue->head, &queue->tail, task);
+      task->state = TASK_RUNNING;
+      run_here    = true;
+
+      mutexLock(&pool.lock);
+      pool.queued--;
+      mutexUnlock(&pool.lock);
+    }
+    mutexUnlock(&queue->lock);
+  }
+
+  if (run_here)
+  {
+    task->run(task->arg);
+  }
+  else
+  {
+    mutexLock(&pool.lock);
+    while (task->state != TASK_FINISHED)
+      condWait(&pool.finished, &pool.lock);
+    taskListRemove(&pool.finished_head, &pool.finished_tail, task);
+    mutexUnlock(&pool.lock);
+  }
+
+  task->state = TASK_IDLE;
+  if (task->done)
+    task->done(task->arg);
+}
+
+void editorAddIdleTask(EditorIdleTask *task)
+{
+  if (task->queued)
+    return;
+  task->queued = true;
+  vector_push(idle_tasks, task);
+}
+
+void editorRemoveIdleTask(EditorIdleTask *task)
+{
+  if (!task->queued)
+    return;
+  task->queued = false;
+
+  for (size_t i = 0; i < idle_tasks.size; i++)
+  {
+    if (idle_tasks.data[i] != task)
+      continue;
+
+    memmove(&idle_tasks.data[i], &idle_tasks.data[i + 1],
+            (idle_tasks.size - i - 1) * sizeof(EditorIdleTask *));
+    idle_tasks.size--;
+    if (idle_next > i)
+      idle_next--;
+    return;
+  }
+}
+
+// Give the next idle task in turn a slice
+static bool runIdleSlice(void)
+{
+  if (!idle_tasks.size)
+    return false;
+
+  if (idle_next >= idle_tasks.size)
+    idle_next = 0;
+  EditorIdleTask *task = idle_tasks.data[idle_next++];
+
+  if (task->step(task->arg, getTime() + IDLE_SLICE_US))
+  {
+    editorRemoveIdleTask(task);
+    return true;
+  }
+  return false;
+}
+
+int editorPollTasks(void)
+{
+  bool redraw = false;
+
+  if (pool.started)
+  {
+    for (;;)
+    {
+      mutexLock(&pool.lock);
+      EditorTask *task = pool.finished_head;
+      if (task)
+        taskListRemove(&pool.finished_head, &pool.finished_tail, task);
+      mutexUnlock(&pool.lock);
+
+      if (!task)
+        break;
+
+      task->state = TASK_IDLE;
+      if (task->done)
+        task->done(task->arg);
+      redraw = true;
+    }
+  }
+
+  if (runIdleSlice())
+    redraw = true;
+
+  if (redraw)
+    editorRefreshScreen();
+
+  return idle_tasks.size ? 0 : READ_WAIT_INFINITE;
+}
+
+void editorFreeTasks(void)
+{
+  free(idle_tasks.data);
+  memset(&idle_tasks, 0, sizeof(idle_tasks));
+
+  if (!pool.started)
+    return;
+
+  mutexLock(&pool.lock);
+  pool.quit = true;
+  condBroadcast(&pool.work);
+  mutexUnlock(&pool.lock);
+
+  for (int i = 0; i < pool.running; i++)
+    threadJoin(&pool.threads[i]);
+
+  for (int i = 0; i < pool.count; i++)
+    mutexFree(&pool.queues[i].lock);
+  condFree(&pool.finished);
+  condFree(&pool.work);
+  mutexFree(&pool.lock);
+  memset(&pool, 0, sizeof(pool));
+}
@@ -0,0 +1,110 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "core_utils.h"
+
+/**
+ * enum EditorTaskState - Where a task is in its life
+ * @TASK_IDLE: Not started, or its completion was delivered
+ * @TASK_QUEUED: Waiting in the queue of a worker
+ * @TASK_RUNNING: A worker is running it
+ * @TASK_FINISHED: Ran, its completion wasn't delivered yet
+ */
+typedef enum EditorTaskState
+{
+  TASK_IDLE,
+  TASK_QUEUED,
+  TASK_RUNNING,
+  TASK_FINISHED,
+} EditorTaskState;
+
+/**
+ * struct EditorTask - Work for a worker thread
+ * @run: Called on a worker thread
+ * @done: Called on the main thread once @run returned, may be NULL
+ * @arg: Passed to @run and @done
+ * @state: See EditorTaskState, guarded by the queue the task is in
+ * @queue: Worker queue the task was put in
+ * @prev: Previous task of the same queue
+ * @next: Next task of the same queue
+ *
+ * The caller owns the memory of the task, it must stay valid until @done
+ * was called. @done may free it.
+ */
+typedef struct EditorTask
+{
+  void (*run)(void *arg);
+  void (*done)(void *arg);
+  void *arg;
+
+  EditorTaskState    state;
+  int                queue;
+  struct EditorTask *prev;
+  struct EditorTask *next;
+} EditorTask;
+
+/**
+ * struct EditorIdleTask - Work done on the main thread between keypresses
+ * @step: Does a slice of the work, returns true once all of it is done
+ * @arg: Passed to @step
+ * @queued: Whether the task is waiting for its next slice
+ *
+ * @step gets the time its slice ends at, see getTime(), and should return
+ * soon after it. It is called again when the editor is idle until it
+ * returns true, so input is never delayed by more than one slice.
+ */
+typedef struct EditorIdleTask
+{
+  bool (*step)(void *arg, int64_t deadline);
+  void *arg;
+  bool  queued;
+} EditorIdleTask;
+
+/**
+ * editorStartTask - Run a task on the worker pool
+ * @task: The task, @run, @done and @arg set
+ *
+ * Workers are started on first use, one for each core. Each worker takes
+ * tasks from its own queue and steals from the others when it runs dry.
+ * If no worker can be started, the task runs right away.
+ */
+void editorStartTask(EditorTask *task);
+
+/**
+ * editorWaitTask - Wait for a task and deliver its completion now
+ * @task: A started task
+ *
+ * A task that no worker took yet runs on the calling thread.
+ */
+void editorWaitTask(EditorTask *task);
+
+/**
+ * editorAddIdleTask - Queue work to do while the editor is idle
+ * @task: The task, @step and @arg set
+ */
+void editorAddIdleTask(EditorIdleTask *task);
+
+/**
+ * editorRemoveIdleTask - Stop giving time slices to an idle task
+ * @task: The task, it may already be done
+ */
+void editorRemoveIdleTask(EditorIdleTask *task);
+
+/**
+ * editorPollTasks - Deliver finished tasks and run a slice of idle work
+ *
+ * Called by the main loop while it waits for input. Workers wake the wait
+ * up when they finish a task.
+ *
+ * Returns: 0 if idle tasks want more time, READ_WAIT_INFINITE otherwise
+ */
+int editorPollTasks(void);
+
+/**
+ * editorFreeTasks - Stop the workers
+ *
+ * Tasks still queued are dropped without their completion.
+ */
+void editorFreeTasks(void);
+
+#endif
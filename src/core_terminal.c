@@ -2,8 +2,10 @@
 
 #include "core_config.h"
 #include "core_editor.h"
+#include "core_file_io.h"
 #include "core_os.h"
 #include "core_output.h"
+#include "core_task.h"
 #include "core_unicode.h"
 #include "core_utils.h"
 
@@ -125,6 +127,145 @@ static bool parseMouseSGR(const char *seq, int *Cb, int *Cx, int *Cy, char *fin)
   return true;
 }
 
+#define PASTE_END "\x1b[201~"
+
+/**
+ * editorReadPasteBlock - Read the content of a bracketed paste
+ * @block: Receives the pasted bytes
+ * @timeout: Time in milliseconds to wait for more input
+ *
+ * Takes the buffered input chunk by chunk and only looks at single bytes
+ * around escape characters, where the end marker may start.
+ *
+ * Returns: false if the input stopped before the end marker
+ */
+static bool editorReadPasteBlock(abuf *block, int timeout)
+{
+  const size_t marker_len = sizeof(PASTE_END) - 1;
+
+  while (true)
+  {
+    const char *data;
+    size_t      len = peekConsoleBytes(&data, timeout);
+    if (!len)
+      return false;
+
+    const char *esc = memchr(data, ESC, len);
+    size_t      pos = esc ? (size_t) (esc - data) : len;
+    abufAppendN(block, data, pos);
+    consumeConsoleBytes(pos);
+    if (!esc)
+      continue;
+
+    // The marker may continue in the next chunk
+    size_t matched = 0;
+    while (matched < marker_len)
+    {
+      if (!peekConsoleBytes(&data, timeout))
+        return false;
+      if (data[0] != PASTE_END[matched])
+        break;
+      consumeConsoleBytes(1);
+      matched++;
+    }
+
+    if (matched == marker_len)
+      return true;
+
+    // Not the end, the escape sequence so far is pasted text
+    abufAppendN(block, PASTE_END, matched);
+  }
+}
+
+/**
+ * editorSplitPaste - Split pasted bytes into lines
+ * @clipboard: Receives the lines
+ * @block: Pasted bytes, owned by @clipboard afterwards
+ *
+ * The lines point into @block, nothing is copied. CRLF, CR and LF all end
+ * a line.
+ */
+static void editorSplitPaste(EditorClipboard *clipboard, abuf *block)
+{
+  memset(clipboard, 0, sizeof(EditorClipboard));
+  if (!block->len)
+  {
+    abufFree(block);
+    return;
+  }
+
+  VECTOR(Str) lines = {0};
+
+  char *line = block->buf;
+  char *end  = block->buf + block->len;
+  for (char *p = line; p < end; p++)
+  {
+    if (*p != '\r' && *p != '\n')
+      continue;
+
+    Str s_line = {.data = line, .size = p - line};
+    vector_push(lines, s_line);
+
+    if (*p == '\r' && p + 1 < end && p[1] == '\n')
+      p++;
+    line = p + 1;
+  }
+
+  Str s_line = {.data = line, .size = end - line};
+  vector_push(lines, s_line);
+  vector_shrink(lines);
+
+  clipboard->size  = lines.size;
+  clipboard->lines = lines.data;
+  clipboard->block = editorNewTextBlock(block->buf, lines.data);
+}
+
+// Time between looks at the input while a long operation runs
+#define CANCEL_POLL_US 20000
+
+// getTime() is only called once in this many cancel checks
+#define CANCEL_CHECK_STRIDE 256
+
+bool editorCheckCancel(void)
+{
+  static unsigned checks = 0;
+  static int64_t  last   = 0;
+
+  if (++checks % CANCEL_CHECK_STRIDE)
+    return false;
+
+  int64_t now = getTime();
+  if (now - last < CANCEL_POLL_US)
+    return false;
+  last = now;
+
+  const char *data;
+  size_t      size = pollConsoleBytes(&data);
+  for (size_t i = 0; i < size; i++)
+  {
+    // Escape sequences of other keys and the mouse start with ESC too,
+    // only a lone one is a press of the key
+    bool esc = data[i] == ESC && (i + 1 == size || data[i + 1] == ESC);
+    if (esc || data[i] == CTRL_KEY('c'))
+    {
+      // Keys typed while waiting were meant for what came before
+      consumeConsoleBytes(i + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Shorter of two waits, READ_WAIT_INFINITE being the longest
+static int minWait(int a, int b)
+{
+  if (a == READ_WAIT_INFINITE)
+    return b;
+  if (b == READ_WAIT_INFINITE)
+    return a;
+  return a < b ? a : b;
+}
+
 EditorInput editorReadKey(void)
 {
   static bool scroll_pressed = false;
@@ -132,8 +273,15 @@ EditorInput editorReadKey(void)
   uint32_t    c;
   EditorInput result = {.type = UNKNOWN};
 
-  while (!readConsole(&c, READ_WAIT_INFINITE))
+  // Sync swap files, follow background saves and run tasks while waiting
+  // for input
+  for (;;)
   {
+    int wait = editorSyncSwap();
+    wait     = minWait(wait, editorPollSaves());
+    wait     = minWait(wait, editorPollTasks());
+    if (waitConsole(wait) && readConsole(&c, 0))
+      break;
   }
 
   int timeout = CONVAR_GETINT(ttimeoutlen);
@@ -177,97 +325,16 @@ EditorInput editorReadKey(void)
     // Bracketed paste
     if (strcmp(seq, "[200~") == 0)
     {
-      VECTOR(Str) content = {0};
-      abuf line           = ABUF_INIT;
-
-      bool last_was_cr = false;
-      while (true)
+      abuf block = ABUF_INIT;
+      if (!editorReadPasteBlock(&block, timeout))
       {
-        if (!readConsole(&c, timeout))
-        {
-          free(content.data);
-          abufFree(&line);
-          return result;
-        }
-
-        if (c == ESC)
-        {
-          uint32_t   end_seq[5];
-          bool       is_end      = true;
-          const char expected[5] = {'[', '2', '0', '1', '~'};
-
-          size_t index;
-          for (index = 0; index < sizeof(end_seq) / sizeof(end_seq[0]); index++)
-          {
-            if (!readConsole(&end_seq[index], timeout))
-            {
-              free(content.data);
-              abufFree(&line);
-              return result;
-            }
-
-            if (end_seq[index] != (uint32_t) expected[index])
-            {
-              is_end = false;
-              break;
-            }
-          }
-
-          if (is_end)
-          {
-            EditorClipboard clipboard = {0};
-            if (content.size || line.len)
-            {
-              Str s_line = {
-                  .data = line.buf,
-                  .size = line.len,
-              };
-              vector_push(content, s_line);
-              vector_shrink(content);
-
-              clipboard.size  = content.size;
-              clipboard.lines = content.data;
-            }
-
-            result.type       = PASTE_INPUT;
-            result.data.paste = clipboard;
-            return result;
-          }
-
-          // paste the escape sequence so far in
-          abufAppendN(&line, expected, index);
-          // let the rest of the logic handle the last input
-          c = end_seq[index];
-        }
-
-        if (c == '\r' || c == '\n')
-        {
-          if (c == '\n' && last_was_cr)
-          {
-            last_was_cr = false;
-            continue;
-          }
-
-          last_was_cr = (c == '\r');
-
-          Str s_line = {
-              .data = line.buf,
-              .size = line.len,
-          };
-          vector_push(content, s_line);
-          memset(&line, 0, sizeof(abuf));
-        }
-        else
-        {
-          last_was_cr = false;
-
-          char utf8[4];
-          int  bytes = encodeUTF8(c, utf8);
-          if (bytes == -1)
-            continue;
-          abufAppendN(&line, utf8, bytes);
-        }
+        abufFree(&block);
+        return result;
       }
+
+      result.type = PASTE_INPUT;
+      editorSplitPaste(&result.data.paste, &block);
+      return result;
     }
 
     // Mouse input
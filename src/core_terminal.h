@@ -91,6 +91,17 @@ void        editorInitTerminal(void);
 EditorInput editorReadKey(void);
 void        editorFreeInput(EditorInput *input);
 
+/**
+ * editorCheckCancel - Check whether the user wants to stop a long operation
+ *
+ * Meant to be called on every iteration of a long loop, the input is only
+ * looked at every few milliseconds. ESC and Ctrl+C cancel, they are taken
+ * from the input along with the keys typed before them.
+ *
+ * Returns: true if the operation should stop
+ */
+bool editorCheckCancel(void);
+
 void enableMouse(void);
 void disableMouse(void);
 
@@ -174,43 +174,6 @@ bool strToColor(const char *color, Color *out)
   return true;
 }
 
-/**
- * Menambahkan escape sequence warna ANSI ke buffer
- * @param ab: append buffer
- * @param color: struktur warna RGB
- * @param is_bg: 1 untuk background, 0 untuk foreground
- */
-void setColor(abuf *ab, Color color, int is_bg)
-{
-  char buf[32];
-  int  len;
-  // Warna hitam (0,0,0) pada background diubah ke default background
-  if (color.r == 0 && color.g == 0 && color.b == 0 && is_bg)
-  {
-    len = snprintf(buf, sizeof(buf), "%s", ANSI_DEFAULT_BG);
-  }
-  else
-  {
-    // Format ANSI: ESC[38;2;R;G;Bm untuk foreground, ESC[48;2;R;G;Bm untuk background
-    len = snprintf(buf, sizeof(buf), "\x1b[%d;2;%d;%d;%dm", is_bg ? 48 : 38, color.r, color.g,
-                   color.b);
-  }
-  abufAppendN(ab, buf, len);
-}
-
-/**
- * Pindahkan kursor ke posisi (x, y) menggunakan ANSI escape sequence
- * @param ab: append buffer
- * @param x: baris (1-based)
- * @param y: kolom (1-based)
- */
-void gotoXY(abuf *ab, int x, int y)
-{
-  char buf[32];
-  int  len = snprintf(buf, sizeof(buf), "\x1b[%d;%dH", x, y);
-  abufAppendN(ab, buf, len);
-}
-
 /**
  * Konversi struktur Color ke string hexadecimal
  * @param color: struktur warna RGB
@@ -506,57 +469,250 @@ char *strCaseStr(const char *str, const char *sub_str)
   return NULL;
 }
 
+// Tabel huruf kecil untuk pencarian case-insensitive, hanya ASCII seperti
+// tolower() di locale "C"
+#define FOLD(c) ((c) >= 'A' && (c) <= 'Z' ? (c) + ('a' - 'A') : (c))
+#define FOLD4(c) FOLD(c), FOLD((c) + 1), FOLD((c) + 2), FOLD((c) + 3)
+#define FOLD16(c) FOLD4(c), FOLD4((c) + 4), FOLD4((c) + 8), FOLD4((c) + 12)
+#define FOLD64(c) FOLD16(c), FOLD16((c) + 16), FOLD16((c) + 32), FOLD16((c) + 48)
+
+static const uint8_t fold_table[256] = {FOLD64(0), FOLD64(64), FOLD64(128), FOLD64(192)};
+
+// Setelah sebanyak ini kandidat gagal, cek apakah memchr masih berguna
+#define SEARCH_MISSES_MIN 16
+// memchr dianggap tidak berguna jika rata-rata kandidat gagal lebih rapat
+// dari jarak ini
+#define SEARCH_MISS_GAP 32
+
+#define SWAR_ONES 0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+
 /**
- * Mencari posisi substring dalam string
+ * Perkiraan seberapa sering sebuah byte muncul di teks dan kode
+ * @param c: byte yang dinilai
+ * @return: semakin besar semakin sering
+ */
+static int byteFrequency(uint8_t c)
+{
+  // Huruf dari yang paling sering muncul dalam teks bahasa Inggris
+  static const char letters[] = "etaoinsrhldcumfpgwybvkxjqz";
+
+  if (c == ' ')
+    return 100;
+  if (c >= 'a' && c <= 'z')
+    return 90 - (int) (strchr(letters, c) - letters);
+  if (c >= 'A' && c <= 'Z')
+    return 50 - (int) (strchr(letters, FOLD(c)) - letters);
+  if (c == '\t')
+    return 60;
+  if (c >= '0' && c <= '9')
+    return 55;
+  if (ispunct(c))
+    return 40;
+  return 0;
+}
+
+/**
+ * Mencari byte pertama yang sama dengan a atau b, 8 byte sekaligus
+ * @param s: data yang dicari
+ * @param n: panjang data
+ * @param a: byte pertama
+ * @param b: byte kedua
+ * @return: pointer ke byte yang ditemukan, atau NULL jika tidak ada
+ */
+static const char *findByte2(const char *s, size_t n, uint8_t a, uint8_t b)
+{
+  const char *end = s + n;
+  uint64_t    pa  = a * SWAR_ONES;
+  uint64_t    pb  = b * SWAR_ONES;
+
+  while (end - s >= 8)
+  {
+    uint64_t word;
+    memcpy(&word, s, 8);
+    uint64_t x = word ^ pa;
+    uint64_t y = word ^ pb;
+
+    // Bit tertinggi menyala di byte yang nol, yaitu byte yang cocok
+    if ((((x - SWAR_ONES) & ~x) | ((y - SWAR_ONES) & ~y)) & SWAR_HIGHS)
+      break;
+    s += 8;
+  }
+
+  for (; s < end; s++)
+  {
+    if ((uint8_t) *s == a || (uint8_t) *s == b)
+      return s;
+  }
+  return NULL;
+}
+
+/**
+ * Menyiapkan pencarian substring
+ * @param search: pencarian yang disiapkan
+ * @param needle: substring yang dicari, harus tetap ada selama search dipakai
+ * @param len: panjang needle
+ * @param ignore_case: true untuk case-insensitive
+ *
+ * Byte needle yang paling jarang muncul dicari dulu dengan memchr, lalu
+ * seluruh needle dicocokkan di posisi itu. Tabel geser Horspool dipakai
+ * jika byte itu ternyata sering muncul di haystack.
+ */
+void strSearchInit(StrSearch *search, const char *needle, size_t len, bool ignore_case)
+{
+  search->needle      = needle;
+  search->len         = len;
+  search->ignore_case = ignore_case;
+  search->rare        = 0;
+
+  int best = INT_MAX;
+  for (size_t i = 0; i < len; i++)
+  {
+    uint8_t c    = ignore_case ? fold_table[(uint8_t) needle[i]] : (uint8_t) needle[i];
+    int     freq = byteFrequency(c);
+    // Huruf case-insensitive perlu dicari dalam dua bentuk, sedikit lebih lambat
+    if (ignore_case && c >= 'a' && c <= 'z')
+      freq += 5;
+    if (freq < best)
+    {
+      best         = freq;
+      search->rare = i;
+    }
+  }
+
+  uint8_t rare          = len ? (uint8_t) needle[search->rare] : 0;
+  bool    both          = ignore_case && isalpha(rare);
+  search->rare_bytes[0] = both ? (uint8_t) tolower(rare) : rare;
+  search->rare_bytes[1] = both ? (uint8_t) toupper(rare) : rare;
+
+  for (size_t i = 0; i < 256; i++)
+    search->shift[i] = len;
+  for (size_t i = 0; i + 1 < len; i++)
+  {
+    uint8_t c        = (uint8_t) needle[i];
+    search->shift[c] = len - 1 - i;
+    if (ignore_case && isalpha(c))
+    {
+      search->shift[tolower(c)] = len - 1 - i;
+      search->shift[toupper(c)] = len - 1 - i;
+    }
+  }
+}
+
+/**
+ * Mencocokkan seluruh needle di satu posisi
+ * @param search: pencarian yang sudah disiapkan
+ * @param s: posisi di haystack, minimal sepanjang needle
+ * @return: true jika cocok
+ */
+static bool strSearchMatch(const StrSearch *search, const char *s)
+{
+  if (!search->ignore_case)
+    return memcmp(s, search->needle, search->len) == 0;
+
+  for (size_t i = 0; i < search->len; i++)
+  {
+    if (fold_table[(uint8_t) s[i]] != fold_table[(uint8_t) search->needle[i]])
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Mencari dengan algoritma Horspool, byte terakhir setiap jendela
+ * menentukan seberapa jauh jendela digeser
+ * @param search: pencarian yang sudah disiapkan
  * @param haystack: string yang dicari
  * @param haystack_len: panjang haystack
- * @param needle: substring yang dicari
- * @param needle_len: panjang needle
  * @param start: posisi mulai pencarian
- * @param ignore_case: true untuk case-insensitive
  * @return: indeks posisi ditemukan, atau -1 jika tidak ada
  */
-int findSubstring(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len,
-                  size_t start, bool ignore_case)
+static int strSearchHorspool(const StrSearch *search, const char *haystack, size_t haystack_len,
+                             size_t start)
 {
-  if (needle_len == 0)
+  size_t  len  = search->len;
+  uint8_t last = (uint8_t) search->needle[len - 1];
+  if (search->ignore_case)
+    last = fold_table[last];
+
+  for (size_t i = start; i + len <= haystack_len;)
   {
-    return (start <= haystack_len) ? (int) start : -1;
+    uint8_t c = (uint8_t) haystack[i + len - 1];
+    if ((search->ignore_case ? fold_table[c] : c) == last && strSearchMatch(search, haystack + i))
+      return (int) i;
+    i += search->shift[c];
   }
+  return -1;
+}
 
-  if (haystack_len < needle_len)
-    return -1;
+/**
+ * Mencari posisi needle berikutnya dalam haystack
+ * @param search: pencarian yang sudah disiapkan dengan strSearchInit()
+ * @param haystack: string yang dicari
+ * @param haystack_len: panjang haystack
+ * @param start: posisi mulai pencarian
+ * @return: indeks posisi ditemukan, atau -1 jika tidak ada
+ */
+int strSearchNext(const StrSearch *search, const char *haystack, size_t haystack_len,
+                  size_t start)
+{
+  size_t len = search->len;
+  if (len == 0)
+    return (start <= haystack_len) ? (int) start : -1;
 
-  size_t limit = haystack_len - needle_len;
-  if (start > limit)
+  if (haystack_len < len || start > haystack_len - len)
     return -1;
 
-  // Cari dari posisi start hingga limit
-  for (size_t i = start; i <= limit; ++i)
+  // Byte langka di jendela terakhir berada tepat sebelum end
+  size_t      rare   = search->rare;
+  const char *p      = haystack + start + rare;
+  const char *end    = haystack + haystack_len - len + rare + 1;
+  size_t      misses = 0;
+
+  while (p < end)
   {
-    size_t j = 0;
-    // Cocokkan setiap karakter
-    for (; j < needle_len; ++j)
-    {
-      uint8_t hay = (uint8_t) haystack[i + j];
-      uint8_t nee = (uint8_t) needle[j];
-      if (ignore_case)
-      {
-        if (tolower(hay) != tolower(nee))
-          break;
-      }
-      else if (hay != nee)
-      {
-        break;
-      }
-    }
-    if (j == needle_len)
-      return (int) i; // Substring ditemukan di posisi i
+    if (search->rare_bytes[0] == search->rare_bytes[1])
+      p = memchr(p, search->rare_bytes[0], end - p);
+    else
+      p = findByte2(p, end - p, search->rare_bytes[0], search->rare_bytes[1]);
+    if (!p)
+      return -1;
+
+    const char *candidate = p - rare;
+    if (strSearchMatch(search, candidate))
+      return (int) (candidate - haystack);
+    p++;
+
+    // Byte itu ternyata sering muncul, memchr berhenti terlalu sering
+    misses++;
+    if (len > 2 && misses >= SEARCH_MISSES_MIN &&
+        (size_t) (candidate - haystack) - start < misses * SEARCH_MISS_GAP)
+      return strSearchHorspool(search, haystack, haystack_len, candidate - haystack + 1);
   }
 
   return -1;
 }
 
+/**
+ * Mencari posisi substring dalam string
+ * @param haystack: string yang dicari
+ * @param haystack_len: panjang haystack
+ * @param needle: substring yang dicari
+ * @param needle_len: panjang needle
+ * @param start: posisi mulai pencarian
+ * @param ignore_case: true untuk case-insensitive
+ * @return: indeks posisi ditemukan, atau -1 jika tidak ada
+ *
+ * Untuk mencari needle yang sama berkali-kali, siapkan StrSearch sekali saja.
+ */
+int findSubstring(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len,
+                  size_t start, bool ignore_case)
+{
+  StrSearch search;
+  strSearchInit(&search, needle, needle_len, ignore_case);
+  return strSearchNext(&search, haystack, haystack_len, start);
+}
+
 /**
  * Konversi string ke integer dengan validasi
  * @param str: string yang akan dikonversi
@@ -616,6 +772,24 @@ int strToInt(const char *str)
 // Tabel karakter untuk encoding Base64
 static const char basis_64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+/**
+ * Hitung hash FNV-1a 64-bit, bisa dilanjutkan dari hash sebelumnya
+ * @param hash: HASH_INIT atau hasil panggilan sebelumnya
+ * @param data: data yang di-hash
+ * @param size: panjang data
+ * @return: hash baru
+ */
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+  const uint8_t *p = (const uint8_t *) data;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 /**
  * Encode data ke format Base64
  * @param string: data input yang akan diencode
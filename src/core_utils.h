@@ -84,7 +84,6 @@ typedef struct Color
 
 bool strToColor(const char *color, Color *out);
 int  colorToStr(Color color, char buf[8]);
-void setColor(abuf *ab, Color color, int is_bg);
 
 // Separator
 typedef int (*IsCharFunc)(int c);
@@ -101,8 +100,7 @@ char *getDirName(char *path);
 void  addDefaultExtension(char *path, const char *extension, int path_length);
 
 // Misc
-void gotoXY(abuf *ab, int x, int y);
-int  getDigit(int n);
+int getDigit(int n);
 
 // String
 int64_t getLine(char **lineptr, size_t *n, FILE *stream);
@@ -110,8 +108,28 @@ int     strCaseCmp(const char *s1, const char *s2);
 char   *strCaseStr(const char *str, const char *sub_str);
 int findSubstring(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len,
                   size_t start, bool ignore_case);
+
+// Substring search, the needle is prepared once for searching many
+// haystacks and must stay valid while the search is used
+typedef struct StrSearch
+{
+  const char *needle;
+  size_t      len;
+  bool        ignore_case;
+  size_t      rare;           // Needle byte looked for first
+  uint8_t     rare_bytes[2];  // Its values, both cases if ignore_case
+  size_t      shift[256];     // Horspool shift by the last byte of a window
+} StrSearch;
+
+void strSearchInit(StrSearch *search, const char *needle, size_t len, bool ignore_case);
+int  strSearchNext(const StrSearch *search, const char *haystack, size_t haystack_len,
+                   size_t start);
 int strToInt(const char *str);
 
+// Hash
+#define HASH_INIT 0xcbf29ce484222325ULL
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size);
+
 // Base64
 static inline int base64EncodeLen(int len)
 {
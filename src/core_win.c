@@ -2,11 +2,14 @@
 
 #include "core_os.h"
 #include "core_terminal.h"
+#include "core_unicode.h"
+#include "core_utils.h"
 
 #include <shellapi.h>
 
 static HANDLE hStdin  = INVALID_HANDLE_VALUE;
 static HANDLE hStdout = INVALID_HANDLE_VALUE;
+static HANDLE hWake   = NULL;
 
 static UINT  orig_cp_in;
 static UINT  orig_cp_out;
@@ -21,6 +24,9 @@ void osInit(void)
   hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
   if (hStdout == INVALID_HANDLE_VALUE)
     PANIC("Failed to get handle for standard output");
+  hWake = CreateEventW(NULL, FALSE, FALSE, NULL);
+  if (hWake == NULL)
+    PANIC("Failed to create wake event");
 }
 
 void enableRawMode(void)
@@ -63,11 +69,17 @@ void disableRawMode(void)
   SetConsoleOutputCP(orig_cp_out);
 }
 
+// Remaining repeats of a held key reported by a single key event
+static DWORD repeat_left = 0;
+static WCHAR repeat_char = 0;
+
+// UTF-8 bytes taken by peekConsoleBytes() but not consumed yet
+static char   pending[4096];
+static size_t pending_start = 0;
+static size_t pending_end   = 0;
+
 static bool readConsoleWChar(WCHAR *out, int timeout_ms)
 {
-  static DWORD repeat_left = 0;
-  static WCHAR repeat_char = 0;
-
   if (repeat_left)
   {
     *out = repeat_char;
@@ -139,6 +151,45 @@ static bool readConsoleWChar(WCHAR *out, int timeout_ms)
   return false;
 }
 
+bool hasConsoleInput(void)
+{
+  if (repeat_left || pending_start < pending_end)
+    return true;
+
+  DWORD avail = 0;
+  if (!GetNumberOfConsoleInputEvents(hStdin, &avail) || avail == 0)
+    return false;
+
+  // Only key presses produce input, ignore key releases and focus events
+  INPUT_RECORD recs[64];
+  DWORD        read = 0;
+  if (!PeekConsoleInputW(hStdin, recs, 64, &read))
+    return false;
+
+  for (DWORD i = 0; i < read; i++)
+  {
+    if (recs[i].EventType == KEY_EVENT && recs[i].Event.KeyEvent.bKeyDown &&
+        recs[i].Event.KeyEvent.uChar.UnicodeChar)
+      return true;
+  }
+  return false;
+}
+
+bool waitConsole(int timeout_ms)
+{
+  if (repeat_left || pending_start < pending_end)
+    return true;
+
+  HANDLE handles[2] = {hStdin, hWake};
+  DWORD  wait       = (timeout_ms < 0) ? INFINITE : (DWORD) timeout_ms;
+  return WaitForMultipleObjects(2, handles, FALSE, wait) == WAIT_OBJECT_0;
+}
+
+void wakeConsole(void)
+{
+  SetEvent(hWake);
+}
+
 int writeConsole(const void *buf, size_t count)
 {
   DWORD bytes_written;
@@ -159,7 +210,8 @@ static inline bool isLowSurrogate(WCHAR u)
   return u >= 0xDC00 && u <= 0xDFFF;
 }
 
-bool readConsole(uint32_t *unicode_out, int timeout_ms)
+// Read a character from the console itself, ignoring pending bytes
+static bool readConsoleUnicode(uint32_t *unicode_out, int timeout_ms)
 {
   WCHAR b0;
   if (!readConsoleWChar(&b0, timeout_ms))
@@ -188,6 +240,68 @@ bool readConsole(uint32_t *unicode_out, int timeout_ms)
   return true;
 }
 
+bool readConsole(uint32_t *unicode_out, int timeout_ms)
+{
+  if (pending_start < pending_end)
+  {
+    size_t byte_size;
+    *unicode_out = decodeUTF8(&pending[pending_start], pending_end - pending_start, &byte_size);
+    pending_start += byte_size;
+    return true;
+  }
+
+  return readConsoleUnicode(unicode_out, timeout_ms);
+}
+
+// Convert everything that is already queued to pending bytes
+static void takeConsoleInput(void)
+{
+  uint32_t c;
+  while (pending_end + 4 <= sizeof(pending) && hasConsoleInput() && readConsoleUnicode(&c, 0))
+  {
+    int bytes = encodeUTF8(c, &pending[pending_end]);
+    if (bytes > 0)
+      pending_end += bytes;
+  }
+}
+
+size_t peekConsoleBytes(const char **data, int timeout_ms)
+{
+  if (pending_start == pending_end)
+  {
+    pending_start = 0;
+    pending_end   = 0;
+
+    uint32_t c;
+    if (!readConsoleUnicode(&c, timeout_ms))
+      return 0;
+
+    int bytes = encodeUTF8(c, &pending[pending_end]);
+    if (bytes > 0)
+      pending_end += bytes;
+    takeConsoleInput();
+  }
+
+  *data = &pending[pending_start];
+  return pending_end - pending_start;
+}
+
+size_t pollConsoleBytes(const char **data)
+{
+  memmove(pending, &pending[pending_start], pending_end - pending_start);
+  pending_end -= pending_start;
+  pending_start = 0;
+  takeConsoleInput();
+
+  *data = pending;
+  return pending_end;
+}
+
+void consumeConsoleBytes(size_t count)
+{
+  pending_start += count;
+}
+
 int getWindowSize(int *rows, int *cols)
 {
   CONSOLE_SCREEN_BUFFER_INFO csbi;
@@ -303,6 +417,48 @@ FILE *openFile(const char *path, const char *mode)
   return file;
 }
 
+bool makeDir(const char *path)
+{
+  int      size   = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+  wchar_t *w_path = malloc_s(size * sizeof(wchar_t));
+  MultiByteToWideChar(CP_UTF8, 0, path, -1, w_path, size);
+
+  bool result = CreateDirectoryW(w_path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+
+  free(w_path);
+  return result;
+}
+
+bool removeFile(const char *path)
+{
+  int      size   = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+  wchar_t *w_path = malloc_s(size * sizeof(wchar_t));
+  MultiByteToWideChar(CP_UTF8, 0, path, -1, w_path, size);
+
+  bool result = DeleteFileW(w_path);
+
+  free(w_path);
+  return result;
+}
+
+bool syncFile(FILE *fp)
+{
+  return fflush(fp) == 0 && FlushFileBuffers((HANDLE) _get_osfhandle(_fileno(fp)));
+}
+
+bool truncateFile(FILE *fp)
+{
+  return fflush(fp) == 0 && _chsize_s(_fileno(fp), 0) == 0;
+}
+
+bool lockFile(FILE *fp)
+{
+  // Lock a byte far past the end, so others can still read the file
+  OVERLAPPED overlapped = {.OffsetHigh = 0x7FFFFFFF};
+  return LockFileEx((HANDLE) _get_osfhandle(_fileno(fp)),
+                    LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped);
+}
+
 bool changeDir(const char *path)
 {
   return SetCurrentDirectory(path);
@@ -326,6 +482,98 @@ char *getFullPath(const char *path)
   return resolved_path;
 }
 
+bool writerOpen(FileWriter *writer, const char *path)
+{
+  memset(writer, 0, sizeof(FileWriter));
+  MultiByteToWideChar(CP_UTF8, 0, path, -1, writer->path, EDITOR_PATH_MAX);
+  _snwprintf(writer->temp_path, EDITOR_PATH_MAX + 8, L"%ls.~lex", writer->path);
+
+  writer->handle = CreateFileW(writer->temp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+  if (writer->handle == INVALID_HANDLE_VALUE)
+  {
+    writer->in_place = true;
+    writer->handle   = CreateFileW(writer->path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                   FILE_ATTRIBUTE_NORMAL, NULL);
+    if (writer->handle == INVALID_HANDLE_VALUE)
+      return false;
+  }
+
+  // There is no gather write for buffered files, collect small chunks
+  writer->buf_size = 0;
+  writer->buf      = malloc_s(WRITER_BUF_SIZE);
+  return true;
+}
+
+static bool writeAll(HANDLE handle, const char *data, size_t size)
+{
+  while (size)
+  {
+    DWORD chunk = size < 0x40000000 ? (DWORD) size : 0x40000000;
+    DWORD written;
+    if (!WriteFile(handle, data, chunk, &written, NULL))
+      return false;
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+static bool writerFlush(FileWriter *writer)
+{
+  bool ok          = writeAll(writer->handle, writer->buf, writer->buf_size);
+  writer->buf_size = 0;
+  return ok;
+}
+
+bool writerWrite(FileWriter *writer, const Str *chunks, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    size_t size = chunks[i].size;
+    if (writer->buf_size + size > WRITER_BUF_SIZE && !writerFlush(writer))
+      return false;
+
+    if (size >= WRITER_BUF_SIZE)
+    {
+      if (!writeAll(writer->handle, chunks[i].data, size))
+        return false;
+      continue;
+    }
+
+    memcpy(&writer->buf[writer->buf_size], chunks[i].data, size);
+    writer->buf_size += size;
+  }
+  return true;
+}
+
+bool writerCommit(FileWriter *writer)
+{
+  bool ok = writerFlush(writer) && FlushFileBuffers(writer->handle);
+  ok      = CloseHandle(writer->handle) && ok;
+  free(writer->buf);
+  if (writer->in_place)
+    return ok;
+
+  // ReplaceFileW keeps the attributes and ACLs of the old file
+  if (ok && (ReplaceFileW(writer->path, writer->temp_path, NULL, REPLACEFILE_IGNORE_MERGE_ERRORS,
+                          NULL, NULL) ||
+             MoveFileExW(writer->temp_path, writer->path,
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)))
+    return true;
+
+  DeleteFileW(writer->temp_path);
+  return false;
+}
+
+void writerAbort(FileWriter *writer)
+{
+  CloseHandle(writer->handle);
+  free(writer->buf);
+  if (!writer->in_place)
+    DeleteFileW(writer->temp_path);
+}
+
 int64_t getTime(void)
 {
   static const uint64_t EPOCH = ((uint64_t) 116444736000000000ULL);
@@ -343,6 +591,89 @@ int64_t getTime(void)
   return sec * 1000000 + usec;
 }
 
+static DWORD WINAPI threadMain(LPVOID arg)
+{
+  Thread *thread = arg;
+  thread->func(thread->arg);
+  return 0;
+}
+
+bool threadStart(Thread *thread, void (*func)(void *arg), void *arg)
+{
+  thread->func   = func;
+  thread->arg    = arg;
+  thread->handle = CreateThread(NULL, 0, threadMain, thread, 0, NULL);
+  return thread->handle != NULL;
+}
+
+void threadJoin(Thread *thread)
+{
+  WaitForSingleObject(thread->handle, INFINITE);
+  CloseHandle(thread->handle);
+}
+
+int cpuCount(void)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (int) info.dwNumberOfProcessors : 1;
+}
+
+void mutexInit(Mutex *mutex)
+{
+  InitializeCriticalSection(&mutex->handle);
+}
+
+void mutexFree(Mutex *mutex)
+{
+  DeleteCriticalSection(&mutex->handle);
+}
+
+void mutexLock(Mutex *mutex)
+{
+  EnterCriticalSection(&mutex->handle);
+}
+
+void mutexUnlock(Mutex *mutex)
+{
+  LeaveCriticalSection(&mutex->handle);
+}
+
+void condInit(Cond *cond)
+{
+  InitializeConditionVariable(&cond->handle);
+}
+
+void condFree(Cond *cond)
+{
+  UNUSED(cond);
+}
+
+void condWait(Cond *cond, Mutex *mutex)
+{
+  SleepConditionVariableCS(&cond->handle, &mutex->handle, INFINITE);
+}
+
+void condSignal(Cond *cond)
+{
+  WakeConditionVariable(&cond->handle);
+}
+
+void condBroadcast(Cond *cond)
+{
+  WakeAllConditionVariable(&cond->handle);
+}
+
+int64_t atomicLoad(const int64_t *value)
+{
+  return InterlockedCompareExchange64((volatile LONG64 *) value, 0, 0);
+}
+
+void atomicStore(int64_t *value, int64_t new_value)
+{
+  InterlockedExchange64((volatile LONG64 *) value, new_value);
+}
+
 void argsInit(int *argc, char ***argv)
 {
   LPWSTR *w_argv = CommandLineToArgvW(GetCommandLineW(), argc);
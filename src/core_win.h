@@ -28,4 +28,35 @@ struct DirIter
   bool error;
 };
 
+struct Thread
+{
+  HANDLE handle;
+  void (*func)(void *arg);
+  void *arg;
+};
+
+struct Mutex
+{
+  CRITICAL_SECTION handle;
+};
+
+struct Cond
+{
+  CONDITION_VARIABLE handle;
+};
+
+// Small chunks are collected into a buffer of this size before writing
+#define WRITER_BUF_SIZE (64 * 1024)
+
+struct FileWriter
+{
+  HANDLE  handle;
+  bool    in_place;
+  wchar_t path[EDITOR_PATH_MAX + 1];
+  wchar_t temp_path[EDITOR_PATH_MAX + 8];
+
+  char  *buf;
+  size_t buf_size;
+};
+
 #endif